@@ -36,6 +36,9 @@ App *app_new(AppConfig *config)
     gtk_init(NULL, NULL);
     atspi_init();
 
+    // move atspi traffic off the gtk thread
+    worker_start();
+
     // add signal subscription
     app->signal_sigusr1 = g_unix_signal_add(SIGUSR1, signal_start_foreground, app);
     app->signal_sigusr2 = g_unix_signal_add(SIGUSR2, signal_stop_foreground, app);
@@ -46,6 +49,12 @@ App *app_new(AppConfig *config)
     // create the backend
     app->backend = backend_new();
 
+    // connect to the accessibility bus
+    app->bus = bus_new();
+
+    // create the main thread scheduler
+    app->scheduler = scheduler_new(NULL);
+
     // create libraries
     app->keymap = keymap_new();
     app->state = state_new(app->backend, app->keymap);
@@ -56,7 +65,8 @@ App *app_new(AppConfig *config)
 
     // create managers
     app->foreground = foreground_new(config->foreground, app->state, app->emulator,
-                                     app->keyboard, app->pointer, app->focus);
+                                     app->keyboard, app->pointer, app->focus, app->bus,
+                                     app->scheduler);
     app->background = background_new(config->background, app->foreground,
                                      app->keyboard, app->focus);
 
@@ -78,6 +88,12 @@ void app_destroy(App *app)
     state_destroy(app->state);
     keymap_destroy(app->keymap);
 
+    // free the main thread scheduler
+    scheduler_destroy(app->scheduler);
+
+    // free the accessibility bus
+    bus_destroy(app->bus);
+
     // free backend
     backend_destroy(app->backend);
 
@@ -88,6 +104,9 @@ void app_destroy(App *app)
     g_source_remove(app->signal_sigint);
     g_source_remove(app->signal_sigterm);
 
+    // stop the atspi thread
+    worker_stop();
+
     // exit common libraries
     atspi_exit();
 
@@ -25,12 +25,15 @@
 #include "app_config.h"
 
 #include "lib/backend/backend.h"
+#include "lib/bus.h"
 #include "lib/keymap.h"
 #include "lib/state.h"
 #include "lib/emulator.h"
 #include "lib/keyboard.h"
 #include "lib/pointer.h"
 #include "lib/focus.h"
+#include "lib/scheduler.h"
+#include "lib/worker.h"
 
 #include "background/background.h"
 #include "foreground/foreground.h"
@@ -45,6 +48,8 @@ typedef struct App
     guint signal_sigterm;
 
     Backend *backend;
+    Bus *bus;
+    Scheduler *scheduler;
 
     Keymap *keymap;
     State *state;
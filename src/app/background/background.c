@@ -19,7 +19,9 @@
 
 #include "background.h"
 
-static KeyboardEventResponse callback_keyboard(KeyboardEvent event, gpointer background_ptr);
+static void callback_keyboard(KeyboardEvent event, gpointer background_ptr);
+static void callback_keyboard_repeat(KeyboardEvent event, gpointer background_ptr);
+static void callback_keyboard_region(KeyboardEvent event, gpointer background_ptr);
 static void callback_focus(AtspiAccessible *window, gpointer background_ptr);
 
 // creates a background that can be run
@@ -40,6 +42,9 @@ Background *background_new(BackgroundConfig *config, Foreground *foreground,
     // add trigger event
     background->trigger_keysym = config->keysym;
     background->trigger_modifiers = config->modifiers;
+    background->repeat_keysym = config->repeat_keysym;
+    background->region_keysym = config->region_keysym;
+    background->region_size = config->region_size;
 
     return background;
 }
@@ -64,6 +69,14 @@ void background_run(Background *background)
     keyboard_subscribe_key(background->keyboard,
                            background->trigger_keysym, background->trigger_modifiers,
                            callback_keyboard, background);
+    if (background->repeat_keysym)
+        keyboard_subscribe_key(background->keyboard,
+                               background->repeat_keysym, background->trigger_modifiers,
+                               callback_keyboard_repeat, background);
+    if (background->region_keysym)
+        keyboard_subscribe_key(background->keyboard,
+                               background->region_keysym, background->trigger_modifiers,
+                               callback_keyboard_region, background);
     focus_subscribe(background->focus, callback_focus, background);
 
     // run loop
@@ -77,6 +90,14 @@ void background_run(Background *background)
     keyboard_unsubscribe_key(background->keyboard,
                              background->trigger_keysym, background->trigger_modifiers,
                              callback_keyboard, background);
+    if (background->repeat_keysym)
+        keyboard_unsubscribe_key(background->keyboard,
+                                 background->repeat_keysym, background->trigger_modifiers,
+                                 callback_keyboard_repeat, background);
+    if (background->region_keysym)
+        keyboard_unsubscribe_key(background->keyboard,
+                                 background->region_keysym, background->trigger_modifiers,
+                                 callback_keyboard_region, background);
     focus_unsubscribe(background->focus, callback_focus, background);
 }
 
@@ -99,7 +120,7 @@ void background_quit(Background *background)
 
 // callback to handle the hotkey input event by scheduling the foreground
 // to start
-static KeyboardEventResponse callback_keyboard(KeyboardEvent event, gpointer background_ptr)
+static void callback_keyboard(KeyboardEvent event, gpointer background_ptr)
 {
     Background *background = background_ptr;
 
@@ -109,8 +130,34 @@ static KeyboardEventResponse callback_keyboard(KeyboardEvent event, gpointer bac
         g_debug("background: Input hotkey triggered");
         foreground_run_async(background->foreground);
     }
+}
+
+// callback to handle the repeat hotkey by executing the last control again. the
+// key grab is active until release, so emulated keys would come back to us
+static void callback_keyboard_repeat(KeyboardEvent event, gpointer background_ptr)
+{
+    Background *background = background_ptr;
+
+    // only check release events
+    if (!event.pressed)
+    {
+        g_debug("background: Repeat hotkey triggered");
+        foreground_repeat(background->foreground);
+    }
+}
 
-    return KEYBOARD_EVENT_CONSUME;
+// callback to handle the region hotkey by scheduling the foreground to start,
+// only showing the controls around the pointer
+static void callback_keyboard_region(KeyboardEvent event, gpointer background_ptr)
+{
+    Background *background = background_ptr;
+
+    // only check press events
+    if (event.pressed)
+    {
+        g_debug("background: Region hotkey triggered");
+        foreground_run_pointer_async(background->foreground, background->region_size);
+    }
 }
 
 // listens for focus events, which can help cache windows and improve speeds
@@ -118,7 +165,9 @@ static void callback_focus(AtspiAccessible *window, gpointer background_ptr)
 {
     if (window)
     {
+        worker_lock();
         const gchar *window_name = atspi_accessible_get_name(window, NULL);
+        worker_unlock();
         g_debug("background: Activated window '%s'", window_name);
         g_free((gpointer)window_name);
     }
@@ -42,6 +42,9 @@ typedef struct Background
 
     guint trigger_keysym;
     GdkModifierType trigger_modifiers;
+    guint repeat_keysym;
+    guint region_keysym;
+    gint region_size;
 } Background;
 
 Background *background_new(BackgroundConfig *config, Foreground *foreground,
@@ -50,6 +50,63 @@ BackgroundConfig *background_new_config(GKeyFile *key_file)
         config->keysym = GDK_KEY_g;
     }
 
+    // get repeat key
+    gchar *repeat_key_string = g_key_file_get_string(key_file, CONFIG_GROUP,
+                                                     "repeat_key", NULL);
+    if (repeat_key_string)
+    {
+        // parse string
+        config->repeat_keysym = gdk_keyval_from_name(repeat_key_string);
+        if (config->repeat_keysym == GDK_KEY_VoidSymbol)
+        {
+            g_warning("config: background: repeat_key: Unknown '%s'", repeat_key_string);
+            config_valid = FALSE;
+        }
+        g_free(repeat_key_string);
+    }
+    else
+    {
+        // default, disabled
+        config->repeat_keysym = 0;
+    }
+
+    // get region key
+    gchar *region_key_string = g_key_file_get_string(key_file, CONFIG_GROUP,
+                                                     "region_key", NULL);
+    if (region_key_string)
+    {
+        // parse string
+        config->region_keysym = gdk_keyval_from_name(region_key_string);
+        if (config->region_keysym == GDK_KEY_VoidSymbol)
+        {
+            g_warning("config: background: region_key: Unknown '%s'", region_key_string);
+            config_valid = FALSE;
+        }
+        g_free(region_key_string);
+    }
+    else
+    {
+        // default, disabled
+        config->region_keysym = 0;
+    }
+
+    // get region size
+    GError *error = NULL;
+    config->region_size = g_key_file_get_integer(key_file, CONFIG_GROUP,
+                                                 "region_size", &error);
+    if (g_error_matches(error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_INVALID_VALUE) ||
+        (!error && config->region_size < 1))
+    {
+        g_warning("config: background: region_size: Parse failed");
+        config_valid = FALSE;
+    }
+    else if (error != NULL)
+    {
+        // default
+        config->region_size = 400;
+    }
+    g_clear_error(&error);
+
     // get modifiers
     gsize num_modifiers;
     gchar **modifier_strings = g_key_file_get_string_list(key_file, CONFIG_GROUP,
@@ -26,6 +26,9 @@
 typedef struct BackgroundConfig
 {
     guint keysym;
+    guint repeat_keysym;
+    guint region_keysym;
+    gint region_size;
     GdkModifierType modifiers;
 } BackgroundConfig;
 
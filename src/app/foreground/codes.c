@@ -208,6 +208,20 @@ void codes_pop_key(Codes *codes)
     codes_apply_code(codes);
 }
 
+// removes all keys from the current code and applies the empty one to the tags
+void codes_clear_code(Codes *codes)
+{
+    // make sure there are keys to remove
+    if (codes->code->len == 0)
+        return;
+
+    // remove all keys
+    codes->code = g_array_remove_range(codes->code, 0, codes->code->len);
+
+    // apply code
+    codes_apply_code(codes);
+}
+
 // applies the current code to all the tags. if no tags match the current code
 // is reset
 static void codes_apply_code(Codes *codes)
@@ -247,3 +261,11 @@ Tag *codes_matched_tag(Codes *codes)
     // no tag found
     return NULL;
 }
+
+// gets how many tags can have codes of at most two keys, without consecutive
+// keys a key is not followed by itself
+guint codes_get_two_key_capacity(Codes *codes)
+{
+    guint keys = codes->keys->len;
+    return codes->consecutive_keys ? keys * keys : keys * (keys - 1);
+}
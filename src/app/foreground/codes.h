@@ -50,6 +50,8 @@ Tag *codes_allocate(Codes *codes);
 void codes_deallocate(Codes *codes, Tag *tag);
 void codes_add_key(Codes *codes, guint key);
 void codes_pop_key(Codes *codes);
+void codes_clear_code(Codes *codes);
 Tag *codes_matched_tag(Codes *codes);
+guint codes_get_two_key_capacity(Codes *codes);
 
 #endif /* B10FD127_9857_4FE9_AF02_AB3EC418F0FF */
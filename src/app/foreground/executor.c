@@ -23,34 +23,107 @@
 
 #include "identify.h"
 
-static gboolean execute_action(Executor *executor, AtspiAccessible *accessible, guint index);
+// longest wait on an action's reply, after which its handler is taken to be
+// running and the action done
+#define EXECUTOR_ACTION_TIMEOUT 10000
+
+// an accessible being executed, which may wait on an action
+typedef struct Execution
+{
+    Executor *executor;
+    BusObject *accessible;
+    AtspiRole role;
+
+    gboolean is_press;
+    ExecuteStrategy known_strategy;
+    gboolean known_tried;
+    guint next_index;
+
+    ExecutorCallback callback;
+    gpointer data;
+} Execution;
+
+static Execution *execution_new(Executor *executor, BusObject *accessible, AtspiRole role,
+                                ExecutorCallback callback, gpointer data);
+static void execution_finish(Execution *execution);
+static void execution_free(Execution *execution);
+
+static void execute_action(Execution *execution, guint index);
+static void execute_action_callback(GObject *source, GAsyncResult *result, gpointer execution_ptr);
 static gboolean execute_key(Executor *executor, guint key, GdkModifierType modifiers);
-static gboolean execute_mouse(Executor *executor, AtspiAccessible *accessible, guint button, GdkModifierType modifiers);
-static gboolean execute_focus(Executor *executor, AtspiAccessible *accessible);
-static gboolean execute_press(Executor *executor, AtspiAccessible *accessible);
+static gboolean execute_mouse(Executor *executor, BusObject *accessible, guint button, GdkModifierType modifiers);
+static gboolean execute_focus(Executor *executor, BusObject *accessible);
+static gboolean execute_strategy(Executor *executor, BusObject *accessible, ExecuteStrategy strategy);
+static void execute_press(Execution *execution);
+static void execute_press_next(Execution *execution);
+
+// strategies to press an accessible, in the order tried when none is known
+static const ExecuteStrategy PRESS_STRATEGIES[] = {
+    EXECUTE_STRATEGY_ACTION,
+    EXECUTE_STRATEGY_FOCUS,
+    EXECUTE_STRATEGY_MOUSE,
+};
 
 // creates a new executor
-Executor *executor_new(Emulator *emulator)
+Executor *executor_new(Emulator *emulator, Keyboard *keyboard, Bus *bus)
 {
     Executor *executor = g_new(Executor, 1);
 
     // add dependencies
     executor->emulator = emulator;
+    executor->keyboard = keyboard;
+    executor->bus = bus;
+
+    // create members
+    executor->strategies = strategies_new(bus);
+
+    // init executions
+    executor->cancellable = g_cancellable_new();
+    executor->executions = NULL;
 
     return executor;
 }
 
-// destroys an executor
+// destroys an executor, executions waiting on an action are dropped
 void executor_destroy(Executor *executor)
 {
+    // detach the executions, they are freed once their action returns
+    g_cancellable_cancel(executor->cancellable);
+    for (GList *link = executor->executions; link; link = link->next)
+        ((Execution *)link->data)->executor = NULL;
+    g_list_free(executor->executions);
+    g_object_unref(executor->cancellable);
+
+    // free members
+    strategies_destroy(executor->strategies);
+
     g_free(executor);
 }
 
-// executes an accessible by identifying it's control type, and potentially it's shifted variant
-void executor_do(Executor *executor, AtspiAccessible *accessible, gboolean shifted)
+// executes an accessible by identifying it's control type, and potentially it's
+// shifted variant. the callback is called once done, which may be after returning.
+// if given, the role is set to the accessible's role. if it already holds a role,
+// the accessible is only executed if it still has it, otherwise FALSE is returned
+// and the callback is not called
+gboolean executor_do(Executor *executor, BusObject *accessible, gboolean shifted, AtspiRole *role,
+                     ExecutorCallback callback, gpointer data)
 {
     // get control type
-    ControlType control_type = identify_control(accessible);
+    AtspiRole expected_role = role ? *role : ATSPI_ROLE_INVALID;
+    AtspiRole found_role;
+    ControlType control_type = identify_control(executor->bus, accessible, &found_role, NULL);
+    if (role)
+        *role = found_role;
+
+    // make sure the role did not change
+    if (expected_role != ATSPI_ROLE_INVALID && expected_role != found_role)
+    {
+        g_debug("executor: Role changed, not executing");
+        return FALSE;
+    }
+
+    // track the execution
+    Execution *execution = execution_new(executor, accessible, found_role, callback, data);
 
     // todo: figure out how to unset shift if shifted
 
@@ -61,8 +134,8 @@ void executor_do(Executor *executor, AtspiAccessible *accessible, gboolean shift
         break;
 
     case CONTROL_TYPE_PRESS:
-        execute_press(executor, accessible);
-        break;
+        execute_press(execution);
+        return TRUE;
 
     case CONTROL_TYPE_FOCUS:
         execute_focus(executor, accessible);
@@ -70,78 +143,165 @@ void executor_do(Executor *executor, AtspiAccessible *accessible, gboolean shift
 
     case CONTROL_TYPE_TAB:
         if (!shifted)
-            execute_press(executor, accessible);
-        else
-            execute_mouse(executor, accessible, 2, 0);
-
+        {
+            execute_press(execution);
+            return TRUE;
+        }
+        execute_mouse(executor, accessible, 2, 0);
         break;
 
     case CONTROL_TYPE_LINK:
         if (!shifted)
         {
-            execute_press(executor, accessible);
-        }
-        else
-        {
-            // attempt using ctrl + return key
-            if (execute_focus(executor, accessible) &&
-                execute_key(executor, GDK_KEY_Return, GDK_CONTROL_MASK))
-                break;
-
-            // attempt using ctrl + mouse click
-            if (execute_mouse(executor, accessible, 1, GDK_CONTROL_MASK))
-                break;
+            execute_press(execution);
+            return TRUE;
         }
+
+        // attempt using ctrl + return key
+        if (execute_focus(executor, accessible) &&
+            execute_key(executor, GDK_KEY_Return, GDK_CONTROL_MASK))
+            break;
+
+        // attempt using ctrl + mouse click
+        if (execute_mouse(executor, accessible, 1, GDK_CONTROL_MASK))
+            break;
+
         break;
 
     case CONTROL_TYPE_FOCUSABLE:
         // get the number of actions
-        AtspiAction *action = atspi_accessible_get_action_iface(accessible);
-        gint n_actions = 0;
-        if (action)
-        {
-            n_actions = atspi_action_get_n_actions(action, NULL);
-            g_object_unref(action);
-        }
+        gint n_actions = bus_get_n_actions(executor->bus, accessible, NULL);
 
         // execute the action or focus
         if (n_actions > 0)
-            execute_action(executor, accessible, 0);
-        else
-            execute_focus(executor, accessible);
-
+        {
+            execute_action(execution, 0);
+            return TRUE;
+        }
+        execute_focus(executor, accessible);
         break;
 
     case CONTROL_TYPE_SELECTABLE:
         // attempt to press
-        execute_press(executor, accessible);
-        break;
+        execute_press(execution);
+        return TRUE;
     }
+
+    // done
+    execution_finish(execution);
+    return TRUE;
 }
 
-// execute the given accessible's action
-static gboolean execute_action(Executor *executor, AtspiAccessible *accessible, guint index)
+// creates an execution tracked by the executor
+static Execution *execution_new(Executor *executor, BusObject *accessible, AtspiRole role,
+                                ExecutorCallback callback, gpointer data)
 {
-    g_debug("executor: Attempting action '%d'", index);
+    Execution *execution = g_new(Execution, 1);
 
-    // get action
-    AtspiAction *action = atspi_accessible_get_action_iface(accessible);
-    if (!action)
-        return FALSE;
+    // set the accessible
+    execution->executor = executor;
+    execution->accessible = bus_object_copy(accessible);
+    execution->role = role;
+
+    // init the press strategies
+    execution->is_press = FALSE;
+    execution->known_strategy = EXECUTE_STRATEGY_NONE;
+    execution->known_tried = FALSE;
+    execution->next_index = 0;
+
+    // set the callback
+    execution->callback = callback;
+    execution->data = data;
+
+    // track
+    executor->executions = g_list_prepend(executor->executions, execution);
+
+    return execution;
+}
+
+// completes an execution, notifying and freeing it
+static void execution_finish(Execution *execution)
+{
+    // stop tracking
+    Executor *executor = execution->executor;
+    executor->executions = g_list_remove(executor->executions, execution);
+
+    // notify
+    if (execution->callback)
+        execution->callback(execution->data);
+
+    execution_free(execution);
+}
+
+// frees an execution
+static void execution_free(Execution *execution)
+{
+    bus_object_free(execution->accessible);
+    g_free(execution);
+}
+
+// starts the given accessible's action, the execution continues once it returns
+static void execute_action(Execution *execution, guint index)
+{
+    Executor *executor = execution->executor;
+    g_debug("executor: Attempting action '%d'", index);
 
     // make sure there is an action
-    gint num_actions = atspi_action_get_n_actions(action, NULL);
-    if (num_actions < index)
-        return FALSE;
+    gint num_actions = bus_get_n_actions(executor->bus, execution->accessible, NULL);
+    if (num_actions < 0 || num_actions <= index)
+    {
+        // continue as failed
+        if (execution->is_press)
+            execute_press_next(execution);
+        else
+            execution_finish(execution);
+        return;
+    }
 
-    // do the action
-    gboolean success = atspi_action_do_action(action, index, NULL);
-    g_object_unref(action);
-    if (!success)
-        return FALSE;
+    // do the action without waiting on it
+    bus_do_action_async(executor->bus, execution->accessible, index, EXECUTOR_ACTION_TIMEOUT,
+                        executor->cancellable, execute_action_callback, execution);
+}
 
-    // success
-    return TRUE;
+// continues an execution once its action returns. an action that timed out is
+// taken as done, as its handler is likely still running, but is not remembered
+// as the strategy that works
+static void execute_action_callback(GObject *source, GAsyncResult *result, gpointer execution_ptr)
+{
+    Execution *execution = execution_ptr;
+
+    // get the result
+    GError *error = NULL;
+    gboolean success = bus_do_action_finish(result, &error);
+    gboolean timed_out = g_error_matches(error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT);
+    if (timed_out)
+    {
+        g_debug("executor: Action did not return in time, taking it as done");
+        success = TRUE;
+    }
+    g_clear_error(&error);
+
+    // drop if the executor is gone
+    if (!execution->executor)
+    {
+        execution_free(execution);
+        return;
+    }
+
+    // continue to the next press strategy on failure
+    if (execution->is_press && !success)
+    {
+        execute_press_next(execution);
+        return;
+    }
+
+    // remember the strategy that worked
+    if (execution->is_press && !timed_out)
+        strategies_set(execution->executor->strategies, execution->accessible,
+                       execution->role, EXECUTE_STRATEGY_ACTION);
+
+    // done
+    execution_finish(execution);
 }
 
 // presses and releases the given key
@@ -149,78 +309,128 @@ static gboolean execute_key(Executor *executor, guint key, GdkModifierType modif
 {
     g_debug("executor: Pressing key '%d'", key);
 
-    // attempt key press
-    return emulator_key(executor->emulator, key, modifiers);
+    // attempt key press, with the keyboard released if grabbed
+    keyboard_suspend(executor->keyboard);
+    gboolean is_success = emulator_key(executor->emulator, key, modifiers);
+    keyboard_resume(executor->keyboard);
+    return is_success;
 }
 
 // executes a mouse click of the button into the center of the given accessible
-static gboolean execute_mouse(Executor *executor, AtspiAccessible *accessible, guint button, GdkModifierType modifiers)
+static gboolean execute_mouse(Executor *executor, BusObject *accessible, guint button, GdkModifierType modifiers)
 {
     g_debug("executor: Clicking mouse '%d'", button);
 
     // get position of the center of the accessible
-    AtspiComponent *component = atspi_accessible_get_component_iface(accessible);
-    if (!component)
+    AtspiRect bounds;
+    if (!bus_get_extents(executor->bus, accessible, &bounds, NULL))
         return FALSE;
-    AtspiRect *bounds = atspi_component_get_extents(component, ATSPI_COORD_TYPE_SCREEN, NULL);
-    gint x = bounds->x + bounds->width / 2;
-    gint y = bounds->y + bounds->height / 2;
-    g_object_unref(component);
-    g_free(bounds);
-
-    // attempt mouse press
-    return emulator_button(executor->emulator, button, modifiers, x, y);
+    gint x = bounds.x + bounds.width / 2;
+    gint y = bounds.y + bounds.height / 2;
+
+    // attempt mouse press, with the keyboard released if grabbed
+    keyboard_suspend(executor->keyboard);
+    gboolean is_success = emulator_button(executor->emulator, button, modifiers, x, y);
+    keyboard_resume(executor->keyboard);
+    return is_success;
 }
 
 // grabs the input focus onto the given accessible
-static gboolean execute_focus(Executor *executor, AtspiAccessible *accessible)
+static gboolean execute_focus(Executor *executor, BusObject *accessible)
 {
     g_debug("executor: Focusing accessible");
 
     // check for focusable state
-    AtspiStateSet *states = atspi_accessible_get_state_set(accessible);
-    gboolean focusable = atspi_state_set_contains(states, ATSPI_STATE_FOCUSABLE);
-    g_object_unref(states);
-    if (!focusable)
-        return FALSE;
-
-    // get component
-    AtspiComponent *component = atspi_accessible_get_component_iface(accessible);
-    if (!component)
+    guint64 states;
+    if (!bus_get_states(executor->bus, accessible, &states, NULL) || !(states & BUS_STATE(ATSPI_STATE_FOCUSABLE)))
         return FALSE;
 
     // grab focus
-    gboolean success = atspi_component_grab_focus(component, NULL);
-    g_object_unref(component);
-    if (!success)
+    if (!bus_grab_focus(executor->bus, accessible, NULL))
         return FALSE;
 
     // check if now contains focused state
-    states = atspi_accessible_get_state_set(accessible);
-    gboolean focused = atspi_state_set_contains(states, ATSPI_STATE_FOCUSED);
-    g_object_unref(states);
-    if (!focused)
+    if (!bus_get_states(executor->bus, accessible, &states, NULL) || !(states & BUS_STATE(ATSPI_STATE_FOCUSED)))
         return FALSE;
 
     // success
     return TRUE;
 }
 
-// attempt to press an accessible, like lift-clicking with a mouse on a button
-static gboolean execute_press(Executor *executor, AtspiAccessible *accessible)
+// attempt a strategy to press an accessible that completes right away
+static gboolean execute_strategy(Executor *executor, BusObject *accessible, ExecuteStrategy strategy)
 {
-    // attempt press using action
-    if (execute_action(executor, accessible, 0))
-        return TRUE;
+    switch (strategy)
+    {
+    case EXECUTE_STRATEGY_FOCUS:
+        // attempt press using return key
+        return execute_focus(executor, accessible) &&
+               execute_key(executor, GDK_KEY_Return, 0);
 
-    // attempt press using return key
-    if (execute_focus(executor, accessible) &&
-        execute_key(executor, GDK_KEY_Return, 0))
-        return TRUE;
+    case EXECUTE_STRATEGY_MOUSE:
+        // attempt press using mouse click
+        return execute_mouse(executor, accessible, 1, 0);
 
-    // attempt press using mouse click
-    if (execute_mouse(executor, accessible, 1, 0))
-        return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
+// attempt to press an accessible, like lift-clicking with a mouse on a button.
+// the strategy that last worked for the application and role is tried first
+static void execute_press(Execution *execution)
+{
+    // get the known strategy
+    execution->is_press = TRUE;
+    execution->known_strategy = strategies_get(execution->executor->strategies,
+                                               execution->accessible, execution->role);
+    execution->known_tried = execution->known_strategy == EXECUTE_STRATEGY_NONE;
+
+    // start with it
+    execute_press_next(execution);
+}
+
+// attempt the remaining press strategies in order until one works, remembering it
+static void execute_press_next(Execution *execution)
+{
+    Executor *executor = execution->executor;
+
+    while (TRUE)
+    {
+        // take the known strategy first, then the others
+        ExecuteStrategy strategy;
+        if (!execution->known_tried)
+        {
+            strategy = execution->known_strategy;
+            execution->known_tried = TRUE;
+        }
+        else if (execution->next_index < G_N_ELEMENTS(PRESS_STRATEGIES))
+        {
+            strategy = PRESS_STRATEGIES[execution->next_index++];
+            if (strategy == execution->known_strategy)
+                continue;
+        }
+        else
+        {
+            // out of strategies
+            break;
+        }
+
+        // the action continues once it returns
+        if (strategy == EXECUTE_STRATEGY_ACTION)
+        {
+            execute_action(execution, 0);
+            return;
+        }
+
+        // attempt the others right away
+        if (execute_strategy(executor, execution->accessible, strategy))
+        {
+            strategies_set(executor->strategies, execution->accessible, execution->role, strategy);
+            break;
+        }
+    }
 
-    return FALSE;
+    // done
+    execution_finish(execution);
 }
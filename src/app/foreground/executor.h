@@ -22,15 +22,32 @@
 
 #include <atspi/atspi.h>
 
+#include "strategies.h"
+
 #include "../lib/emulator.h"
+#include "../lib/keyboard.h"
+#include "../lib/bus.h"
+
+// callback type used to notify that an execution completed
+typedef void (*ExecutorCallback)(gpointer data);
 
+// executes accessibles by their control type. actions are done without
+// waiting on the application, so an execution may complete later
 typedef struct Executor
 {
     Emulator *emulator;
+    Keyboard *keyboard;
+    Bus *bus;
+
+    Strategies *strategies;
+
+    GCancellable *cancellable;
+    GList *executions;
 } Executor;
 
-Executor *executor_new(Emulator *emulator);
+Executor *executor_new(Emulator *emulator, Keyboard *keyboard, Bus *bus);
 void executor_destroy(Executor *executor);
-void executor_do(Executor *executor, AtspiAccessible *accessible, gboolean shifted);
+gboolean executor_do(Executor *executor, BusObject *accessible, gboolean shifted, AtspiRole *role,
+                     ExecutorCallback callback, gpointer data);
 
 #endif /* DC8D1073_8C84_4BB1_9DF3_49B95D76178D */
@@ -21,18 +21,63 @@
 
 #define SHIFTED_MASK (GDK_SHIFT_MASK | GDK_LOCK_MASK)
 
-static gboolean foreground_run_idle(gpointer foreground_ptr);
-
-static void callback_accessible_add(AtspiAccessible *accessible, gpointer foreground_ptr);
-static void callback_accessible_remove(AtspiAccessible *accessible, gpointer foreground_ptr);
+// size of the cells indexing labels and points
+#define TAG_INDEX_CELL_SIZE 64
+// size of the cells indexing the extents of controls, which can be window sized
+#define EXTENTS_INDEX_CELL_SIZE 256
+// times a label is moved aside before it is left over the others
+#define LABEL_PLACE_ATTEMPTS 8
+
+// keys passed through to the window below, with and without shift
+static const guint PASSTHROUGH_KEYS[] = {
+    GDK_KEY_Up,
+    GDK_KEY_Down,
+    GDK_KEY_Left,
+    GDK_KEY_Right,
+    GDK_KEY_Page_Up,
+    GDK_KEY_Page_Down,
+    GDK_KEY_Home,
+    GDK_KEY_End,
+};
+static const GdkModifierType PASSTHROUGH_MODIFIERS[] = {0, GDK_SHIFT_MASK};
 
-static KeyboardEventResponse callback_keyboard(KeyboardEvent event, gpointer foreground_ptr);
-static PointerEventResponse callback_pointer(PointerEvent event, gpointer foreground_ptr);
+static gboolean foreground_run_idle(gpointer foreground_ptr);
+static AtspiRect foreground_pointer_monitor(Foreground *foreground);
+static void foreground_execute(Foreground *foreground, BusObject *accessible,
+                               ExecutorCallback callback, gpointer data);
+static void foreground_execute_sticky(Foreground *foreground, Tag *tag);
+static gboolean foreground_execute_sticky_idle(gpointer foreground_ptr);
+
+static void foreground_place(Foreground *foreground, BusObject *accessible, AtspiRect extents);
+static void foreground_show_tag(Foreground *foreground, BusObject *accessible, AtspiRect extents);
+static void foreground_hide_tag(Foreground *foreground, Tag *tag);
+static void foreground_cull(Foreground *foreground, BusObject *accessible, AtspiRect extents);
+static void foreground_restore_culled(Foreground *foreground, AtspiRect extents);
+static void foreground_anchor(Foreground *foreground, AtspiRect extents, gint *x, gint *y);
+static AtspiRect foreground_label_area(Foreground *foreground, Tag *tag);
+static gboolean extents_contain(AtspiRect *extents, AtspiRect *other_extents);
+static void foreground_pend(Foreground *foreground, BusObject *accessible, AtspiRect extents);
+static void foreground_pend_all(Foreground *foreground);
+static void foreground_regions_show(Foreground *foreground);
+static void foreground_regions_resume(Foreground *foreground);
+static void foreground_region_pick(Foreground *foreground);
+static gboolean foreground_region_contains(Foreground *foreground, AtspiRect extents);
+static RegistryEntry *foreground_entry_new(BusObject *accessible, AtspiRect extents);
+static void foreground_entry_free(gpointer entry_ptr);
+
+static void callback_accessible_add(RegistryEntry *entry, gpointer foreground_ptr);
+static void callback_accessible_remove(RegistryEntry *entry, gpointer foreground_ptr);
+static void callback_accessible_move(RegistryEntry *entry, gpointer foreground_ptr);
+static void callback_window_move(RegistryEntry *window, gpointer foreground_ptr);
+
+static void callback_keyboard(KeyboardEvent event, gpointer foreground_ptr);
+static void callback_pointer(PointerEvent event, gpointer foreground_ptr);
 static void callback_focus(AtspiAccessible *window, gpointer foreground_ptr);
 
 // creates a new foreground that can be run
 Foreground *foreground_new(ForegroundConfig *config, State *state, Emulator *emulator,
-                           Keyboard *keyboard, Pointer *pointer, Focus *focus)
+                           Keyboard *keyboard, Pointer *pointer, Focus *focus, Bus *bus,
+                           Scheduler *scheduler)
 {
     Foreground *foreground = g_new(Foreground, 1);
 
@@ -40,8 +85,40 @@ Foreground *foreground_new(ForegroundConfig *config, State *state, Emulator *emu
     foreground->loop = g_main_loop_new(NULL, FALSE);
     foreground->is_running = FALSE;
 
+    // init the scope, the whole window unless run for a region
+    foreground->has_scope = FALSE;
+    foreground->scope = (AtspiRect){0, 0, 0, 0};
+
+    // init sticky mode
+    foreground->sticky = FALSE;
+    foreground->sticky_accessible = NULL;
+    foreground->sticky_source_id = 0;
+
+    // init the last executed control
+    foreground->last_accessible = NULL;
+    foreground->last_shifted = FALSE;
+    foreground->last_role = ATSPI_ROLE_INVALID;
+
     // create tag management
-    foreground->accessible_to_tag = g_hash_table_new_full(NULL, NULL, g_object_unref, NULL);
+    foreground->accessible_to_tag = g_hash_table_new_full(bus_object_hash, bus_object_equal, bus_object_free, NULL);
+    foreground->accessible_to_culled = g_hash_table_new_full(bus_object_hash, bus_object_equal, NULL, foreground_entry_free);
+    foreground->tags_index = spatial_new(EXTENTS_INDEX_CELL_SIZE);
+    foreground->labels_index = spatial_new(TAG_INDEX_CELL_SIZE);
+    foreground->culled_index = spatial_new(EXTENTS_INDEX_CELL_SIZE);
+    foreground->tag_config = config->codes->tag;
+
+    // init the grid, shown before the crawl if enabled
+    foreground->grid_fallback = config->grid->enabled;
+    foreground->grid_clicked = FALSE;
+
+    // init regions, picked first once there are more tags than two keys can code
+    foreground->regions = config->grid->regions;
+    foreground->regions_mode = FALSE;
+    foreground->region_is_picked = FALSE;
+    foreground->region = (AtspiRect){0, 0, 0, 0};
+    foreground->window_extents = (AtspiRect){0, 0, 0, 0};
+    foreground->accessible_to_pending = g_hash_table_new_full(bus_object_hash, bus_object_equal, NULL, foreground_entry_free);
+    foreground->pending_index = spatial_new(TAG_INDEX_CELL_SIZE);
 
     // add dependencies
     foreground->state = state;
@@ -49,12 +126,20 @@ Foreground *foreground_new(ForegroundConfig *config, State *state, Emulator *emu
     foreground->keyboard = keyboard;
     foreground->pointer = pointer;
     foreground->focus = focus;
+    foreground->bus = bus;
+    foreground->scheduler = scheduler;
 
     // create members
     foreground->codes = codes_new(config->codes);
     foreground->overlay = overlay_new(config->overlay);
-    foreground->registry = registry_new();
-    foreground->executor = executor_new(emulator);
+    foreground->grid = grid_new(config->grid, config->codes, foreground->overlay);
+    foreground->registry = registry_new(bus, scheduler);
+    foreground->executor = executor_new(emulator, keyboard, bus);
+
+    // let the passthrough keys reach the window below while the keyboard is grabbed
+    for (guint key = 0; key < G_N_ELEMENTS(PASSTHROUGH_KEYS); key++)
+        for (guint modifiers = 0; modifiers < G_N_ELEMENTS(PASSTHROUGH_MODIFIERS); modifiers++)
+            keyboard_relay_key(foreground->keyboard, PASSTHROUGH_KEYS[key], PASSTHROUGH_MODIFIERS[modifiers]);
 
     return foreground;
 }
@@ -62,14 +147,29 @@ Foreground *foreground_new(ForegroundConfig *config, State *state, Emulator *emu
 // destroys and frees a foreground
 void foreground_destroy(Foreground *foreground)
 {
+    // remove the passthrough keys
+    for (guint key = 0; key < G_N_ELEMENTS(PASSTHROUGH_KEYS); key++)
+        for (guint modifiers = 0; modifiers < G_N_ELEMENTS(PASSTHROUGH_MODIFIERS); modifiers++)
+            keyboard_unrelay_key(foreground->keyboard, PASSTHROUGH_KEYS[key], PASSTHROUGH_MODIFIERS[modifiers]);
+
     // free members
     codes_destroy(foreground->codes);
+    grid_destroy(foreground->grid);
     overlay_destroy(foreground->overlay);
     registry_destroy(foreground->registry);
     executor_destroy(foreground->executor);
 
     // free tag management
     g_hash_table_unref(foreground->accessible_to_tag);
+    g_hash_table_unref(foreground->accessible_to_culled);
+    spatial_destroy(foreground->tags_index);
+    spatial_destroy(foreground->labels_index);
+    spatial_destroy(foreground->culled_index);
+    g_hash_table_unref(foreground->accessible_to_pending);
+    spatial_destroy(foreground->pending_index);
+
+    // free the last executed control
+    g_clear_pointer(&foreground->last_accessible, bus_object_free);
 
     // free main loop
     g_main_loop_unref(foreground->loop);
@@ -80,6 +180,11 @@ void foreground_destroy(Foreground *foreground)
 // runs a foreground by starting a g main loop. stopped by calling quit.
 void foreground_run(Foreground *foreground)
 {
+    // take the scope this run was started for
+    gboolean has_scope = foreground->has_scope;
+    AtspiRect scope = foreground->scope;
+    foreground->has_scope = FALSE;
+
     if (foreground_is_running(foreground))
     {
         g_debug("foreground: Foreground is already running");
@@ -90,23 +195,44 @@ void foreground_run(Foreground *foreground)
     foreground->shifted = !!(state_get_modifiers(foreground->state) & SHIFTED_MASK);
     overlay_shifted(foreground->overlay, foreground->shifted);
 
-    // get active window
+    // get active window, the grid can do without one
     AtspiAccessible *window = focus_get_window(foreground->focus);
-    if (!window)
+    if (!window && !foreground->grid_fallback)
     {
         g_warning("foreground: No active window, stopping");
         return;
     }
 
-    // let the registry watch the window
-    registry_watch(foreground->registry, window, (RegistrySubscriber){
-                                                     .add = callback_accessible_add,
-                                                     .remove = callback_accessible_remove,
-                                                     .data = foreground,
-                                                 });
+    // show the overlay, it is placed once the window extents are known
+    foreground->grid_clicked = FALSE;
+    foreground->regions_mode = FALSE;
+    foreground->region_is_picked = FALSE;
+    foreground->sticky = FALSE;
+    overlay_show(foreground->overlay);
 
-    // show the overlay
-    overlay_show(foreground->overlay, window);
+    // show the grid right away over the monitor of the pointer, tags replace it once found
+    foreground->window_extents = foreground_pointer_monitor(foreground);
+    if (foreground->grid_fallback)
+    {
+        overlay_move(foreground->overlay, foreground->window_extents);
+        grid_show(foreground->grid, foreground->window_extents);
+    }
+
+    // let the registry watch the window, or only the scoped part of it
+    AtspiRect *region = NULL;
+    if (has_scope)
+    {
+        g_debug("foreground: Scoped to region (%d, %d, %d, %d)", scope.x, scope.y, scope.width, scope.height);
+        region = &scope;
+    }
+    if (window)
+        registry_watch(foreground->registry, window, region, (RegistrySubscriber){
+                                                                 .add = callback_accessible_add,
+                                                                 .remove = callback_accessible_remove,
+                                                                 .move = callback_accessible_move,
+                                                                 .window = callback_window_move,
+                                                                 .data = foreground,
+                                                             });
 
     // subscribe to listeners
     keyboard_subscribe(foreground->keyboard, callback_keyboard, foreground);
@@ -125,18 +251,43 @@ void foreground_run(Foreground *foreground)
     pointer_unsubscribe(foreground->pointer, callback_pointer, foreground);
     focus_unsubscribe(foreground->focus, callback_focus, foreground);
 
-    // execute control
+    // drop a sticky execution that did not get to run
+    if (foreground->sticky_source_id)
+        g_source_remove(foreground->sticky_source_id);
+    foreground->sticky_source_id = 0;
+    g_clear_pointer(&foreground->sticky_accessible, bus_object_free);
+
+    // keep the matched control, its tag is freed with the registry's controls
     Tag *tag = codes_matched_tag(foreground->codes);
-    if (tag)
+    BusObject *accessible = tag ? bus_object_copy(tag->accessible) : NULL;
+
+    // clean up members, aborting the crawl before executing
+    registry_unwatch(foreground->registry);
+    grid_hide(foreground->grid);
+    overlay_hide(foreground->overlay);
+    if (window)
+    {
+        worker_lock();
+        g_object_unref(window);
+        worker_unlock();
+    }
+
+    // execute control
+    if (accessible)
     {
         g_debug("foreground: Tag matched, executing control");
-        executor_do(foreground->executor, tag->accessible, foreground->shifted);
+        foreground_execute(foreground, accessible, NULL, NULL);
+        bus_object_free(accessible);
     }
 
-    // clean up members
-    registry_unwatch(foreground->registry);
-    overlay_hide(foreground->overlay);
-    g_object_unref(window);
+    // click into the grid
+    if (foreground->grid_clicked)
+    {
+        g_debug("foreground: Grid picked, clicking");
+        gint x, y;
+        grid_get_point(foreground->grid, &x, &y);
+        emulator_button(foreground->emulator, foreground->shifted ? 3 : 1, 0, x, y);
+    }
 }
 
 // runs the foreground from a newly created idle source
@@ -145,6 +296,23 @@ void foreground_run_async(Foreground *foreground)
     g_idle_add_full(G_PRIORITY_HIGH, foreground_run_idle, foreground, NULL);
 }
 
+// runs the foreground from a newly created idle source, only crawling the controls
+// within a region of the screen
+void foreground_run_region_async(Foreground *foreground, AtspiRect region)
+{
+    foreground->has_scope = TRUE;
+    foreground->scope = region;
+    foreground_run_async(foreground);
+}
+
+// runs the foreground from a newly created idle source, only crawling the controls
+// within a square of the given size around the pointer
+void foreground_run_pointer_async(Foreground *foreground, gint size)
+{
+    BackendStateEvent state = state_get_state(foreground->state);
+    foreground_run_region_async(foreground, (AtspiRect){state.pointer_x - size / 2, state.pointer_y - size / 2, size, size});
+}
+
 // returns whether the given foreground is running
 gboolean foreground_is_running(Foreground *foreground)
 {
@@ -159,6 +327,46 @@ void foreground_quit(Foreground *foreground)
     g_main_loop_quit(foreground->loop);
 }
 
+// executes the last executed control again without crawling. it is found by its
+// application and object path, checked to still be showing, and to still have
+// the same role as object paths may be reused
+void foreground_repeat(Foreground *foreground)
+{
+    // skip while running, the keyboard is grabbed
+    if (foreground_is_running(foreground))
+    {
+        g_debug("foreground: Foreground is running, not repeating");
+        return;
+    }
+
+    // make sure a control was executed
+    if (!foreground->last_accessible)
+    {
+        g_debug("foreground: No control to repeat");
+        return;
+    }
+
+    // check the control still exists and is showing with a single call
+    guint64 states;
+    if (!bus_get_states(foreground->bus, foreground->last_accessible, &states, NULL) ||
+        (states & BUS_STATE(ATSPI_STATE_DEFUNCT)) ||
+        !(states & BUS_STATE(ATSPI_STATE_SHOWING)))
+    {
+        g_debug("foreground: Last control is gone, not repeating");
+        g_clear_pointer(&foreground->last_accessible, bus_object_free);
+        return;
+    }
+
+    // execute it again, the executor checks the role as it identifies it
+    g_debug("foreground: Repeating last control");
+    AtspiRole role = foreground->last_role;
+    if (!executor_do(foreground->executor, foreground->last_accessible, foreground->last_shifted, &role, NULL, NULL))
+    {
+        g_debug("foreground: Last control changed, not repeating");
+        g_clear_pointer(&foreground->last_accessible, bus_object_free);
+    }
+}
+
 // idle source function for running the foreground
 static gboolean foreground_run_idle(gpointer foreground_ptr)
 {
@@ -166,31 +374,161 @@ static gboolean foreground_run_idle(gpointer foreground_ptr)
     return G_SOURCE_REMOVE;
 }
 
-// event callback to a new accessible added
-static void callback_accessible_add(AtspiAccessible *accessible, gpointer foreground_ptr)
+// gets the screen area of the monitor under the pointer, without asking the bus
+static AtspiRect foreground_pointer_monitor(Foreground *foreground)
+{
+    BackendStateEvent state = state_get_state(foreground->state);
+    GdkMonitor *monitor = gdk_display_get_monitor_at_point(gdk_display_get_default(), state.pointer_x, state.pointer_y);
+    GdkRectangle geometry;
+    gdk_monitor_get_geometry(monitor, &geometry);
+    return (AtspiRect){geometry.x, geometry.y, geometry.width, geometry.height};
+}
+
+// executes a control and remembers it to be repeated
+static void foreground_execute(Foreground *foreground, BusObject *accessible,
+                               ExecutorCallback callback, gpointer data)
+{
+    // remember the control
+    if (foreground->last_accessible != accessible)
+    {
+        g_clear_pointer(&foreground->last_accessible, bus_object_free);
+        foreground->last_accessible = bus_object_copy(accessible);
+    }
+    foreground->last_shifted = foreground->shifted;
+
+    // execute, remembering the role it was found with
+    foreground->last_role = ATSPI_ROLE_INVALID;
+    executor_do(foreground->executor, accessible, foreground->shifted, &foreground->last_role, callback, data);
+}
+
+// executes the control of a matched tag while staying open, keeping the crawl
+// and tags live. it runs from an idle, as the executor releases the keyboard
+// around emulated input, which can't be done while dispatching a keyboard event.
+static void foreground_execute_sticky(Foreground *foreground, Tag *tag)
+{
+    // skip if an execution is pending
+    if (foreground->sticky_source_id)
+        return;
+
+    // keep the control and start a new code
+    foreground->sticky_accessible = bus_object_copy(tag->accessible);
+    codes_clear_code(foreground->codes);
+
+    // execute once the event is handled
+    foreground->sticky_source_id = g_idle_add_full(G_PRIORITY_HIGH, foreground_execute_sticky_idle, foreground, NULL);
+}
+
+// idle source function for a sticky execution
+static gboolean foreground_execute_sticky_idle(gpointer foreground_ptr)
 {
     Foreground *foreground = foreground_ptr;
+    foreground->sticky_source_id = 0;
+
+    // execute, keeping the keyboard while waiting on an action
+    g_debug("foreground: Tag matched, executing control and staying open");
+    foreground_execute(foreground, foreground->sticky_accessible, NULL, NULL);
+    g_clear_pointer(&foreground->sticky_accessible, bus_object_free);
+
+    return G_SOURCE_REMOVE;
+}
+
+// tags an accessible, resolving labels that would be over each other. of nested
+// accessibles, such as a link in a list item, only the innermost is tagged and
+// the others are culled until it is removed. labels of accessibles that are not
+// nested, such as small adjacent buttons, are moved aside from each other
+static void foreground_place(Foreground *foreground, BusObject *accessible, AtspiRect extents)
+{
+    // find the tags with extents intersecting this one
+    AtspiRect area = {extents.x, extents.y, MAX(extents.width, 1), MAX(extents.height, 1)};
+    GPtrArray *tags = spatial_query(foreground->tags_index, area);
+
+    // cull if covering a tag, the same extents keep the existing tag
+    for (guint index = 0; index < tags->len; index++)
+    {
+        Tag *tag = g_ptr_array_index(tags, index);
+        if (!extents_contain(&extents, &tag->extents))
+            continue;
+
+        foreground_cull(foreground, accessible, extents);
+        g_ptr_array_unref(tags);
+        return;
+    }
+
+    // cull the tags covering it
+    for (guint index = 0; index < tags->len; index++)
+    {
+        Tag *tag = g_ptr_array_index(tags, index);
+        if (!extents_contain(&tag->extents, &extents))
+            continue;
+
+        BusObject *tag_accessible = bus_object_copy(tag->accessible);
+        AtspiRect tag_extents = tag->extents;
+        foreground_hide_tag(foreground, tag);
+        foreground_cull(foreground, tag_accessible, tag_extents);
+        bus_object_free(tag_accessible);
+    }
+    g_ptr_array_unref(tags);
 
+    // tag it
+    foreground_show_tag(foreground, accessible, extents);
+}
+
+// creates and shows a tag for an accessible
+static void foreground_show_tag(Foreground *foreground, BusObject *accessible, AtspiRect extents)
+{
     // create tag
     Tag *tag = codes_allocate(foreground->codes);
 
     // set the accessible
     tag_set_accessible(tag, accessible);
+    tag_set_extents(tag, extents);
+    tag_set_offset(tag, 0);
 
     // add to the overlay
     overlay_add(foreground->overlay, tag);
 
+    // move the label aside past the labels it is over, inwards for labels at
+    // the end of their extents
+    gboolean is_end = foreground->tag_config->alignment_horizontal == GTK_ALIGN_END;
+    for (gint attempt = 0; attempt < LABEL_PLACE_ATTEMPTS; attempt++)
+    {
+        AtspiRect label_area = foreground_label_area(foreground, tag);
+        GPtrArray *labels = spatial_query(foreground->labels_index, label_area);
+        if (labels->len == 0)
+        {
+            g_ptr_array_unref(labels);
+            break;
+        }
+
+        // find the edge past the labels
+        gint edge = is_end ? G_MAXINT : G_MININT;
+        for (guint index = 0; index < labels->len; index++)
+        {
+            AtspiRect other_area = foreground_label_area(foreground, g_ptr_array_index(labels, index));
+            edge = is_end ? MIN(edge, other_area.x) : MAX(edge, other_area.x + other_area.width);
+        }
+        g_ptr_array_unref(labels);
+
+        // stop if it cannot be moved further
+        gint offset = tag->offset_x + (is_end ? edge - (label_area.x + label_area.width) : edge - label_area.x);
+        if (offset == tag->offset_x)
+            break;
+        tag_set_offset(tag, offset);
+    }
+
     // add tag record
-    g_hash_table_insert(foreground->accessible_to_tag, g_object_ref(accessible), tag);
+    g_hash_table_insert(foreground->accessible_to_tag, bus_object_copy(accessible), tag);
+    spatial_insert_area(foreground->tags_index, tag, extents);
+    spatial_insert_area(foreground->labels_index, tag, foreground_label_area(foreground, tag));
 }
 
-// event callback to a previously added accessible being removed
-static void callback_accessible_remove(AtspiAccessible *accessible, gpointer foreground_ptr)
+// hides and frees the tag of an accessible
+static void foreground_hide_tag(Foreground *foreground, Tag *tag)
 {
-    Foreground *foreground = foreground_ptr;
-
-    // get the tag
-    Tag *tag = g_hash_table_lookup(foreground->accessible_to_tag, accessible);
+    // remove tag record
+    spatial_remove(foreground->tags_index, tag);
+    spatial_remove(foreground->labels_index, tag);
+    g_hash_table_remove(foreground->accessible_to_tag, tag->accessible);
 
     // unset the accessible
     tag_unset_accessible(tag);
@@ -200,13 +538,340 @@ static void callback_accessible_remove(AtspiAccessible *accessible, gpointer for
 
     // deallocate tag
     codes_deallocate(foreground->codes, tag);
+}
 
-    // remove tag record
-    g_hash_table_remove(foreground->accessible_to_tag, accessible);
+// keeps an accessible untagged while another is tagged in its place
+static void foreground_cull(Foreground *foreground, BusObject *accessible, AtspiRect extents)
+{
+    RegistryEntry *culled = foreground_entry_new(accessible, extents);
+    g_hash_table_insert(foreground->accessible_to_culled, culled->accessible, culled);
+    spatial_insert_area(foreground->culled_index, culled, extents);
+}
+
+// places the culled accessibles intersecting a removed tag's extents again
+static void foreground_restore_culled(Foreground *foreground, AtspiRect extents)
+{
+    AtspiRect area = {extents.x, extents.y, MAX(extents.width, 1), MAX(extents.height, 1)};
+    GPtrArray *entries = spatial_query(foreground->culled_index, area);
+    for (guint index = 0; index < entries->len; index++)
+    {
+        // take it out of the culled
+        RegistryEntry *culled = g_ptr_array_index(entries, index);
+        BusObject *accessible = bus_object_copy(culled->accessible);
+        AtspiRect culled_extents = culled->extents;
+        spatial_remove(foreground->culled_index, culled);
+        g_hash_table_remove(foreground->accessible_to_culled, accessible);
+
+        // place it again
+        foreground_place(foreground, accessible, culled_extents);
+        bus_object_free(accessible);
+    }
+    g_ptr_array_unref(entries);
+}
+
+// gets the screen point a tag's label is aligned to within its extents
+static void foreground_anchor(Foreground *foreground, AtspiRect extents, gint *x, gint *y)
+{
+    switch (foreground->tag_config->alignment_horizontal)
+    {
+    case GTK_ALIGN_CENTER:
+        *x = extents.x + extents.width / 2;
+        break;
+    case GTK_ALIGN_END:
+        *x = extents.x + extents.width;
+        break;
+    default:
+        *x = extents.x;
+        break;
+    }
+
+    switch (foreground->tag_config->alignment_vertical)
+    {
+    case GTK_ALIGN_CENTER:
+        *y = extents.y + extents.height / 2;
+        break;
+    case GTK_ALIGN_END:
+        *y = extents.y + extents.height;
+        break;
+    default:
+        *y = extents.y;
+        break;
+    }
+}
+
+// gets the screen area a tag's label covers, aligned to its anchor and moved aside by its offset
+static AtspiRect foreground_label_area(Foreground *foreground, Tag *tag)
+{
+    gint x, y;
+    foreground_anchor(foreground, tag->extents, &x, &y);
+    gint width = MAX(tag_get_label_width(tag), 1);
+    gint height = MAX(tag_get_label_height(tag), 1);
+
+    // align the label to the anchor
+    if (foreground->tag_config->alignment_horizontal == GTK_ALIGN_CENTER)
+        x -= width / 2;
+    else if (foreground->tag_config->alignment_horizontal == GTK_ALIGN_END)
+        x -= width;
+    if (foreground->tag_config->alignment_vertical == GTK_ALIGN_CENTER)
+        y -= height / 2;
+    else if (foreground->tag_config->alignment_vertical == GTK_ALIGN_END)
+        y -= height;
+
+    return (AtspiRect){x + tag->offset_x, y, width, height};
+}
+
+// check if extents contain the other extents
+static gboolean extents_contain(AtspiRect *extents, AtspiRect *other_extents)
+{
+    return extents->x <= other_extents->x && extents->y <= other_extents->y &&
+           extents->x + extents->width >= other_extents->x + other_extents->width &&
+           extents->y + extents->height >= other_extents->y + other_extents->height;
+}
+
+// keeps an accessible untagged until a region containing it is picked
+static void foreground_pend(Foreground *foreground, BusObject *accessible, AtspiRect extents)
+{
+    RegistryEntry *pending = foreground_entry_new(accessible, extents);
+    g_hash_table_insert(foreground->accessible_to_pending, pending->accessible, pending);
+    gint x, y;
+    foreground_anchor(foreground, extents, &x, &y);
+    spatial_insert(foreground->pending_index, pending, x, y);
+}
+
+// untags all accessibles, keeping them pending until a region is picked
+static void foreground_pend_all(Foreground *foreground)
+{
+    // pend the tagged, hiding them changes the table
+    GList *tags = g_hash_table_get_values(foreground->accessible_to_tag);
+    for (GList *link = tags; link; link = link->next)
+    {
+        Tag *tag = link->data;
+        BusObject *accessible = bus_object_copy(tag->accessible);
+        AtspiRect extents = tag->extents;
+        foreground_hide_tag(foreground, tag);
+        foreground_pend(foreground, accessible, extents);
+        bus_object_free(accessible);
+    }
+    g_list_free(tags);
+
+    // pend the culled
+    GHashTableIter iter;
+    gpointer accessible_ptr, entry_ptr;
+    g_hash_table_iter_init(&iter, foreground->accessible_to_culled);
+    while (g_hash_table_iter_next(&iter, &accessible_ptr, &entry_ptr))
+    {
+        RegistryEntry *culled = entry_ptr;
+        spatial_remove(foreground->culled_index, culled);
+        foreground_pend(foreground, culled->accessible, culled->extents);
+        g_hash_table_iter_remove(&iter);
+    }
+}
+
+// shows the regions of the window to pick from, untagging everything
+static void foreground_regions_show(Foreground *foreground)
+{
+    g_debug("foreground: Too many tags, picking a region first");
+
+    // untag all
+    foreground->regions_mode = TRUE;
+    foreground->region_is_picked = FALSE;
+    foreground_pend_all(foreground);
+    codes_clear_code(foreground->codes);
+
+    // label the regions with the grid
+    grid_show(foreground->grid, foreground->window_extents);
+}
+
+// shows the regions within the region the grid was last refined to, untagging everything
+static void foreground_regions_resume(Foreground *foreground)
+{
+    // untag all
+    foreground->region_is_picked = FALSE;
+    foreground_pend_all(foreground);
+    codes_clear_code(foreground->codes);
+
+    // label the regions with the grid
+    grid_resume(foreground->grid);
+}
+
+// picks the region the grid is refined to, tagging only the accessibles in it.
+// a region with still more accessibles than two keys can code is refined again
+static void foreground_region_pick(Foreground *foreground)
+{
+    AtspiRect region = grid_get_region(foreground->grid);
+
+    // keep refining the region while it can be
+    GPtrArray *entries = spatial_query(foreground->pending_index, region);
+    if (entries->len > codes_get_two_key_capacity(foreground->codes) && !grid_is_done(foreground->grid))
+    {
+        g_debug("foreground: Too many tags in region, refining it");
+        g_ptr_array_unref(entries);
+        return;
+    }
+
+    // hide the regions
+    foreground->region = region;
+    foreground->region_is_picked = TRUE;
+    grid_hide(foreground->grid);
+
+    // tag the pending accessibles in the region
+    for (guint index = 0; index < entries->len; index++)
+    {
+        // take it out of the pending
+        RegistryEntry *pending = g_ptr_array_index(entries, index);
+        BusObject *accessible = bus_object_copy(pending->accessible);
+        AtspiRect extents = pending->extents;
+        spatial_remove(foreground->pending_index, pending);
+        g_hash_table_remove(foreground->accessible_to_pending, accessible);
+
+        // tag it
+        foreground_place(foreground, accessible, extents);
+        bus_object_free(accessible);
+    }
+    g_ptr_array_unref(entries);
+}
+
+// check if the label of an accessible is in the picked region
+static gboolean foreground_region_contains(Foreground *foreground, AtspiRect extents)
+{
+    gint x, y;
+    foreground_anchor(foreground, extents, &x, &y);
+    AtspiRect *region = &foreground->region;
+    return x >= region->x && x < region->x + region->width &&
+           y >= region->y && y < region->y + region->height;
+}
+
+// creates an entry for an accessible kept without a tag
+static RegistryEntry *foreground_entry_new(BusObject *accessible, AtspiRect extents)
+{
+    RegistryEntry *entry = g_new0(RegistryEntry, 1);
+    entry->accessible = bus_object_copy(accessible);
+    entry->extents = extents;
+    return entry;
+}
+
+// frees an entry for an accessible kept without a tag
+static void foreground_entry_free(gpointer entry_ptr)
+{
+    RegistryEntry *entry = entry_ptr;
+    bus_object_free(entry->accessible);
+    g_free(entry);
+}
+
+// event callback to a new accessible added
+static void callback_accessible_add(RegistryEntry *entry, gpointer foreground_ptr)
+{
+    Foreground *foreground = foreground_ptr;
+
+    // while picking regions, only accessibles in the picked region are tagged
+    if (foreground->regions_mode)
+    {
+        if (!foreground->region_is_picked || !foreground_region_contains(foreground, entry->extents))
+        {
+            foreground_pend(foreground, entry->accessible, entry->extents);
+            return;
+        }
+        foreground_place(foreground, entry->accessible, entry->extents);
+
+        // refine the picked region once it has more tags than two keys can code
+        if (g_hash_table_size(foreground->accessible_to_tag) > codes_get_two_key_capacity(foreground->codes) &&
+            !grid_is_done(foreground->grid))
+            foreground_regions_resume(foreground);
+        return;
+    }
+
+    // the first tag replaces the grid
+    grid_hide(foreground->grid);
+
+    // tag the accessible unless its label would be over another
+    foreground_place(foreground, entry->accessible, entry->extents);
+
+    // pick a region first once there are more tags than two keys can code
+    if (foreground->regions && g_hash_table_size(foreground->accessible_to_tag) > codes_get_two_key_capacity(foreground->codes))
+        foreground_regions_show(foreground);
+}
+
+// event callback to a previously added accessible being removed
+static void callback_accessible_remove(RegistryEntry *entry, gpointer foreground_ptr)
+{
+    Foreground *foreground = foreground_ptr;
+
+    // forget a pending accessible
+    RegistryEntry *pending = g_hash_table_lookup(foreground->accessible_to_pending, entry->accessible);
+    if (pending)
+    {
+        spatial_remove(foreground->pending_index, pending);
+        g_hash_table_remove(foreground->accessible_to_pending, entry->accessible);
+        return;
+    }
+
+    // forget a culled accessible
+    RegistryEntry *culled = g_hash_table_lookup(foreground->accessible_to_culled, entry->accessible);
+    if (culled)
+    {
+        spatial_remove(foreground->culled_index, culled);
+        g_hash_table_remove(foreground->accessible_to_culled, entry->accessible);
+        return;
+    }
+
+    // remove the tag
+    Tag *tag = g_hash_table_lookup(foreground->accessible_to_tag, entry->accessible);
+    AtspiRect extents = tag->extents;
+    foreground_hide_tag(foreground, tag);
+
+    // tag the accessibles it was covering
+    foreground_restore_culled(foreground, extents);
+}
+
+// event callback to a previously added accessible being moved. labels that come
+// to be over each other are left, culling them again would change codes as typed
+static void callback_accessible_move(RegistryEntry *entry, gpointer foreground_ptr)
+{
+    Foreground *foreground = foreground_ptr;
+    gint x, y;
+    foreground_anchor(foreground, entry->extents, &x, &y);
+
+    // move a pending accessible
+    RegistryEntry *pending = g_hash_table_lookup(foreground->accessible_to_pending, entry->accessible);
+    if (pending)
+    {
+        pending->extents = entry->extents;
+        spatial_move(foreground->pending_index, pending, x, y);
+        return;
+    }
+
+    // move a culled accessible
+    RegistryEntry *culled = g_hash_table_lookup(foreground->accessible_to_culled, entry->accessible);
+    if (culled)
+    {
+        culled->extents = entry->extents;
+        spatial_move_area(foreground->culled_index, culled, entry->extents);
+        return;
+    }
+
+    // move the tag
+    Tag *tag = g_hash_table_lookup(foreground->accessible_to_tag, entry->accessible);
+    tag_set_extents(tag, entry->extents);
+    spatial_move_area(foreground->tags_index, tag, entry->extents);
+    spatial_move_area(foreground->labels_index, tag, foreground_label_area(foreground, tag));
+}
+
+// event callback to the watched window being moved
+static void callback_window_move(RegistryEntry *window, gpointer foreground_ptr)
+{
+    Foreground *foreground = foreground_ptr;
+
+    // move the overlay
+    foreground->window_extents = window->extents;
+    overlay_move(foreground->overlay, window->extents);
+
+    // fit the grid to the window
+    if (grid_is_shown(foreground->grid))
+        grid_set_region(foreground->grid, window->extents);
 }
 
 // event callback for all keyboard events
-static KeyboardEventResponse callback_keyboard(KeyboardEvent event, gpointer foreground_ptr)
+static void callback_keyboard(KeyboardEvent event, gpointer foreground_ptr)
 {
     Foreground *foreground = foreground_ptr;
 
@@ -222,7 +887,7 @@ static KeyboardEventResponse callback_keyboard(KeyboardEvent event, gpointer for
 
     // don't use key if modifiers other than the shift mods are held
     if (current_mods & ~SHIFTED_MASK)
-        return KEYBOARD_EVENT_CONSUME;
+        return;
 
     // process key type
     g_debug("foreground: Checking key %s event for '%s'", (event.pressed) ? "pressed" : "released", gdk_keyval_name(event.keysym));
@@ -240,42 +905,89 @@ static KeyboardEventResponse callback_keyboard(KeyboardEvent event, gpointer for
     case GDK_KEY_Page_Down:
     case GDK_KEY_Home:
     case GDK_KEY_End:
-        // pass these keys through to the window below
+        // these keys are passed through to the window below by the keyboard relays
         g_debug("foreground: Passing keysym (%d) to application", event.keysym);
-        return KEYBOARD_EVENT_RELAY;
+        break;
+    case GDK_KEY_Tab:
+    case GDK_KEY_ISO_Left_Tab:
+        // only check pressed
+        if (!event.pressed)
+            break;
+        // toggle staying open after executing
+        foreground->sticky = !foreground->sticky;
+        g_debug("foreground: Sticky mode %s", foreground->sticky ? "on" : "off");
+        break;
+    case GDK_KEY_Return:
+    case GDK_KEY_space:
+        // only check pressed
+        if (!event.pressed)
+            break;
+        // click into the grid, only once refined so a stray key does not click the monitor's center
+        if (grid_is_shown(foreground->grid) && !foreground->regions_mode && grid_is_refined(foreground->grid))
+        {
+            foreground->grid_clicked = TRUE;
+            foreground_quit(foreground);
+        }
+        break;
     case GDK_KEY_BackSpace:
         // only check pressed
         if (!event.pressed)
             break;
-        // remove the last key
-        codes_pop_key(foreground->codes);
+        // remove the last key, going back a region once the code is empty
+        if (grid_is_shown(foreground->grid))
+            grid_pop_key(foreground->grid);
+        else if (foreground->region_is_picked && foreground->codes->code->len == 0)
+        {
+            grid_pop_key(foreground->grid);
+            foreground_regions_resume(foreground);
+        }
+        else
+            codes_pop_key(foreground->codes);
         break;
     default:
         // only check pressed
         if (!event.pressed)
             break;
+        // pick a region to tag
+        if (grid_is_shown(foreground->grid) && foreground->regions_mode)
+        {
+            if (grid_add_key(foreground->grid, event.keysym))
+                foreground_region_pick(foreground);
+            break;
+        }
+        // refine the grid, the grid takes over from the crawl once picked from
+        if (grid_is_shown(foreground->grid))
+        {
+            if (!grid_add_key(foreground->grid, event.keysym))
+                break;
+            registry_unwatch(foreground->registry);
+            if (grid_is_done(foreground->grid))
+            {
+                foreground->grid_clicked = TRUE;
+                foreground_quit(foreground);
+            }
+            break;
+        }
         // add this key
         codes_add_key(foreground->codes, event.keysym);
-        // quit if matched
-        if (codes_matched_tag(foreground->codes))
+        // quit if matched, or execute and stay open when sticky
+        Tag *tag = codes_matched_tag(foreground->codes);
+        if (tag && foreground->sticky)
+            foreground_execute_sticky(foreground, tag);
+        else if (tag)
             foreground_quit(foreground);
         break;
     }
-
-    return KEYBOARD_EVENT_CONSUME;
 }
 
 // event callback for all pointer events
-static PointerEventResponse callback_pointer(PointerEvent event, gpointer foreground_ptr)
+static void callback_pointer(PointerEvent event, gpointer foreground_ptr)
 {
     g_debug("foreground: Pointer event received, button '%d'", event.button);
 
     // quit for non scrolling buttons
     if (event.button != 4 && event.button != 5)
         foreground_quit(foreground_ptr);
-
-    // relay the event
-    return POINTER_EVENT_RELAY;
 }
 
 // event callback for window focus changes
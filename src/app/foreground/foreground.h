@@ -27,13 +27,17 @@
 #include "registry.h"
 #include "codes.h"
 #include "overlay.h"
+#include "grid.h"
 #include "executor.h"
+#include "spatial.h"
 
 #include "../lib/state.h"
 #include "../lib/emulator.h"
 #include "../lib/keyboard.h"
 #include "../lib/pointer.h"
 #include "../lib/focus.h"
+#include "../lib/bus.h"
+#include "../lib/scheduler.h"
 
 // a foreground which when run will show an overlay populated with tags with codes.
 // key events will narrow down the codes, an when one code is focused on, that
@@ -44,27 +48,60 @@ typedef struct Foreground
     gboolean is_running;
 
     GHashTable *accessible_to_tag;
+    GHashTable *accessible_to_culled;
+    Spatial *tags_index;
+    Spatial *labels_index;
+    Spatial *culled_index;
+    TagConfig *tag_config;
 
     gboolean shifted;
+    gboolean grid_fallback;
+    gboolean grid_clicked;
+
+    gboolean regions;
+    gboolean regions_mode;
+    gboolean region_is_picked;
+    AtspiRect region;
+    AtspiRect window_extents;
+    GHashTable *accessible_to_pending;
+    Spatial *pending_index;
+
+    gboolean has_scope;
+    AtspiRect scope;
+
+    gboolean sticky;
+    BusObject *sticky_accessible;
+    guint sticky_source_id;
+
+    BusObject *last_accessible;
+    gboolean last_shifted;
+    AtspiRole last_role;
 
     State *state;
     Emulator *emulator;
     Keyboard *keyboard;
     Pointer *pointer;
     Focus *focus;
+    Bus *bus;
+    Scheduler *scheduler;
 
     Registry *registry;
     Codes *codes;
     Overlay *overlay;
+    Grid *grid;
     Executor *executor;
 } Foreground;
 
 Foreground *foreground_new(ForegroundConfig *config, State *state, Emulator *emulator,
-                           Keyboard *keyboard, Pointer *pointer, Focus *focus);
+                           Keyboard *keyboard, Pointer *pointer, Focus *focus, Bus *bus,
+                           Scheduler *scheduler);
 void foreground_destroy(Foreground *foreground);
 void foreground_run(Foreground *foreground);
 void foreground_run_async(Foreground *foreground);
+void foreground_run_region_async(Foreground *foreground, AtspiRect region);
+void foreground_run_pointer_async(Foreground *foreground, gint size);
 gboolean foreground_is_running(Foreground *foreground);
 void foreground_quit(Foreground *foreground);
+void foreground_repeat(Foreground *foreground);
 
 #endif /* AD82229D_9BCD_4C49_AC37_47128F926D4E */
@@ -36,6 +36,11 @@ ForegroundConfig *foreground_new_config(GKeyFile *key_file)
     if (!config->codes)
         config_valid = FALSE;
 
+    // get grid
+    config->grid = grid_new_config(key_file);
+    if (!config->grid)
+        config_valid = FALSE;
+
     // return
     if (!config_valid)
     {
@@ -53,6 +58,7 @@ void foreground_destroy_config(ForegroundConfig *config)
 
     overlay_destroy_config(config->overlay);
     codes_destroy_config(config->codes);
+    grid_destroy_config(config->grid);
 
     g_free(config);
 }
\ No newline at end of file
@@ -24,12 +24,14 @@
 
 #include "overlay_config.h"
 #include "codes_config.h"
+#include "grid_config.h"
 
 // configuration for a foreground
 typedef struct ForegroundConfig
 {
     OverlayConfig *overlay;
     CodesConfig *codes;
+    GridConfig *grid;
 } ForegroundConfig;
 
 ForegroundConfig *foreground_new_config(GKeyFile *key_file);
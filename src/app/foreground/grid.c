@@ -0,0 +1,226 @@
+/**
+ * Copyright (C) 2021 Ryan Britton
+ *
+ * This file is part of Goodnight Mouse.
+ *
+ * Goodnight Mouse is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Goodnight Mouse is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Goodnight Mouse.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "grid.h"
+
+#include <gdk/gdk.h>
+
+static AtspiRect grid_current_region(Grid *grid);
+static AtspiRect grid_cell(Grid *grid, guint index);
+static void grid_layout(Grid *grid);
+
+// creates a new grid with a tag for each of the code keys
+Grid *grid_new(GridConfig *config, CodesConfig *codes_config, Overlay *overlay)
+{
+    Grid *grid = g_new(Grid, 1);
+
+    // save the keys and size
+    grid->keys = g_array_copy(codes_config->keys);
+    grid->minimum_size = config->minimum_size;
+
+    // add dependencies
+    grid->overlay = overlay;
+
+    // create a single key tag for each cell
+    grid->tags = g_ptr_array_new_with_free_func((GDestroyNotify)tag_destroy);
+    for (guint index = 0; index < grid->keys->len; index++)
+    {
+        Tag *tag = tag_new(codes_config->tag);
+        GArray *code = g_array_new(FALSE, FALSE, sizeof(guint));
+        g_array_append_val(code, g_array_index(grid->keys, guint, index));
+        tag_set_code(tag, code);
+        g_array_unref(code);
+        g_ptr_array_add(grid->tags, tag);
+    }
+
+    // init regions
+    grid->regions = g_array_new(FALSE, FALSE, sizeof(AtspiRect));
+    grid->is_shown = FALSE;
+
+    return grid;
+}
+
+// destroys and frees a grid
+void grid_destroy(Grid *grid)
+{
+    // remove from the overlay
+    grid_hide(grid);
+
+    // free members
+    g_ptr_array_unref(grid->tags);
+    g_array_unref(grid->regions);
+    g_array_unref(grid->keys);
+
+    g_free(grid);
+}
+
+// shows the grid over the given screen region
+void grid_show(Grid *grid, AtspiRect region)
+{
+    // set the region first so tags are placed before being shown
+    grid_set_region(grid, region);
+
+    // show the tags
+    grid_resume(grid);
+}
+
+// shows the grid again at the region it was refined to when hidden
+void grid_resume(Grid *grid)
+{
+    // do nothing if already shown
+    if (grid->is_shown)
+        return;
+    grid->is_shown = TRUE;
+
+    // add the tags to the overlay
+    for (guint index = 0; index < grid->tags->len; index++)
+        overlay_add(grid->overlay, g_ptr_array_index(grid->tags, index));
+}
+
+// hides the grid, the picked region is kept until shown again
+void grid_hide(Grid *grid)
+{
+    // do nothing if not shown
+    if (!grid->is_shown)
+        return;
+    grid->is_shown = FALSE;
+
+    // remove the tags from the overlay
+    for (guint index = 0; index < grid->tags->len; index++)
+        overlay_remove(grid->overlay, g_ptr_array_index(grid->tags, index));
+}
+
+// sets the region the grid covers, dropping any refinements
+void grid_set_region(Grid *grid, AtspiRect region)
+{
+    g_array_set_size(grid->regions, 0);
+    g_array_append_val(grid->regions, region);
+    grid_layout(grid);
+}
+
+// returns whether the grid is shown
+gboolean grid_is_shown(Grid *grid)
+{
+    return grid->is_shown;
+}
+
+// returns whether a cell has been picked
+gboolean grid_is_refined(Grid *grid)
+{
+    return grid->regions->len > 1;
+}
+
+// refines the grid into the cell of the given key, returns whether the key
+// belonged to a cell
+gboolean grid_add_key(Grid *grid, guint key)
+{
+    // convert to lower
+    key = gdk_keyval_to_lower(key);
+
+    // find the cell of the key
+    for (guint index = 0; index < grid->keys->len; index++)
+    {
+        if (key != g_array_index(grid->keys, guint, index))
+            continue;
+
+        // refine into the cell
+        AtspiRect cell = grid_cell(grid, index);
+        g_array_append_val(grid->regions, cell);
+        grid_layout(grid);
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+// goes back to the previous region
+void grid_pop_key(Grid *grid)
+{
+    // make sure a region can be popped
+    if (!grid_is_refined(grid))
+        return;
+
+    // remove the last region
+    g_array_remove_index(grid->regions, grid->regions->len - 1);
+    grid_layout(grid);
+}
+
+// returns whether the current region is small enough to click into
+gboolean grid_is_done(Grid *grid)
+{
+    AtspiRect region = grid_current_region(grid);
+    return region.width <= grid->minimum_size && region.height <= grid->minimum_size;
+}
+
+// gets the center point of the current region
+void grid_get_point(Grid *grid, gint *x, gint *y)
+{
+    AtspiRect region = grid_current_region(grid);
+    *x = region.x + region.width / 2;
+    *y = region.y + region.height / 2;
+}
+
+// gets the current region, the picked cell once refined
+AtspiRect grid_get_region(Grid *grid)
+{
+    return grid_current_region(grid);
+}
+
+// returns the region being divided
+static AtspiRect grid_current_region(Grid *grid)
+{
+    if (grid->regions->len == 0)
+        return (AtspiRect){0, 0, 0, 0};
+    return g_array_index(grid->regions, AtspiRect, grid->regions->len - 1);
+}
+
+// gets the screen extents of a cell, the columns follow the aspect ratio of the
+// region so cells stay roughly square, and the last row is spread over the width
+static AtspiRect grid_cell(Grid *grid, guint index)
+{
+    AtspiRect region = grid_current_region(grid);
+    gint n_cells = grid->keys->len;
+
+    // get the grid dimensions
+    gdouble ratio = (gdouble)MAX(region.width, 1) / MAX(region.height, 1);
+    gint columns = 1;
+    while (columns < n_cells && columns * columns < n_cells * ratio)
+        columns++;
+    gint rows = (n_cells + columns - 1) / columns;
+
+    // get the cell position, the last row can be short
+    gint row = index / columns;
+    gint column = index % columns;
+    if (row == rows - 1)
+        columns = n_cells - row * columns;
+
+    // divide by edges so the cells cover the region without gaps
+    gint x0 = region.x + column * region.width / columns;
+    gint x1 = region.x + (column + 1) * region.width / columns;
+    gint y0 = region.y + row * region.height / rows;
+    gint y1 = region.y + (row + 1) * region.height / rows;
+    return (AtspiRect){x0, y0, x1 - x0, y1 - y0};
+}
+
+// moves each tag over its cell
+static void grid_layout(Grid *grid)
+{
+    for (guint index = 0; index < grid->tags->len; index++)
+        tag_set_extents(g_ptr_array_index(grid->tags, index), grid_cell(grid, index));
+}
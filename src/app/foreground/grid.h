@@ -0,0 +1,60 @@
+/**
+ * Copyright (C) 2021 Ryan Britton
+ *
+ * This file is part of Goodnight Mouse.
+ *
+ * Goodnight Mouse is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Goodnight Mouse is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Goodnight Mouse.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef E3C2050A_48FC_4BEC_BAE7_BF8B220B013B
+#define E3C2050A_48FC_4BEC_BAE7_BF8B220B013B
+
+#include <glib.h>
+#include <atspi/atspi.h>
+
+#include "grid_config.h"
+#include "codes_config.h"
+
+#include "overlay.h"
+#include "tag.h"
+
+// a pointer grid that divides a screen area into cells labelled with the code
+// keys. picking a cell refines the grid into it, until small enough to click.
+typedef struct Grid
+{
+    GArray *keys;
+    gint minimum_size;
+
+    Overlay *overlay;
+    GPtrArray *tags;
+
+    GArray *regions;
+    gboolean is_shown;
+} Grid;
+
+Grid *grid_new(GridConfig *config, CodesConfig *codes_config, Overlay *overlay);
+void grid_destroy(Grid *grid);
+void grid_show(Grid *grid, AtspiRect region);
+void grid_resume(Grid *grid);
+void grid_hide(Grid *grid);
+void grid_set_region(Grid *grid, AtspiRect region);
+gboolean grid_is_shown(Grid *grid);
+gboolean grid_is_refined(Grid *grid);
+gboolean grid_add_key(Grid *grid, guint key);
+void grid_pop_key(Grid *grid);
+gboolean grid_is_done(Grid *grid);
+void grid_get_point(Grid *grid, gint *x, gint *y);
+AtspiRect grid_get_region(Grid *grid);
+
+#endif /* E3C2050A_48FC_4BEC_BAE7_BF8B220B013B */
@@ -0,0 +1,94 @@
+/**
+ * Copyright (C) 2021 Ryan Britton
+ *
+ * This file is part of goodnight_mouse.
+ *
+ * goodnight_mouse is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * goodnight_mouse is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with goodnight_mouse.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "grid_config.h"
+
+#define CONFIG_GROUP "grid"
+
+// creates a new grid configuration from a key file and default values
+GridConfig *grid_new_config(GKeyFile *key_file)
+{
+    // create config
+    GridConfig *config = g_new0(GridConfig, 1);
+    gboolean config_valid = TRUE;
+
+    // get enabled
+    GError *error = NULL;
+    config->enabled = g_key_file_get_boolean(key_file, CONFIG_GROUP,
+                                             "enabled", &error);
+    if (g_error_matches(error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_INVALID_VALUE))
+    {
+        g_warning("config: grid: enabled: Parse failed");
+        config_valid = FALSE;
+    }
+    else if (error != NULL)
+    {
+        // default
+        config->enabled = FALSE;
+    }
+    g_clear_error(&error);
+
+    // get minimum_size
+    config->minimum_size = g_key_file_get_integer(key_file, CONFIG_GROUP,
+                                                  "minimum_size", &error);
+    if (g_error_matches(error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_INVALID_VALUE) ||
+        (!error && config->minimum_size < 1))
+    {
+        g_warning("config: grid: minimum_size: Parse failed");
+        config_valid = FALSE;
+    }
+    else if (error != NULL)
+    {
+        // default
+        config->minimum_size = 16;
+    }
+    g_clear_error(&error);
+
+    // get regions
+    config->regions = g_key_file_get_boolean(key_file, CONFIG_GROUP,
+                                             "regions", &error);
+    if (g_error_matches(error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_INVALID_VALUE))
+    {
+        g_warning("config: grid: regions: Parse failed");
+        config_valid = FALSE;
+    }
+    else if (error != NULL)
+    {
+        // default
+        config->regions = FALSE;
+    }
+    g_clear_error(&error);
+
+    // return
+    if (!config_valid)
+    {
+        grid_destroy_config(config);
+        return NULL;
+    }
+    return config;
+}
+
+// destroys and frees a grid config
+void grid_destroy_config(GridConfig *config)
+{
+    if (!config)
+        return;
+
+    g_free(config);
+}
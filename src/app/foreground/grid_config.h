@@ -0,0 +1,36 @@
+/**
+ * Copyright (C) 2021 Ryan Britton
+ *
+ * This file is part of goodnight_mouse.
+ *
+ * goodnight_mouse is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * goodnight_mouse is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with goodnight_mouse.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BCE4D3B8_79F9_45C2_ADFA_93A1D39EDC9A
+#define BCE4D3B8_79F9_45C2_ADFA_93A1D39EDC9A
+
+#include <glib.h>
+
+// configuration for the pointer grid
+typedef struct GridConfig
+{
+    gboolean enabled;
+    gint minimum_size;
+    gboolean regions;
+} GridConfig;
+
+GridConfig *grid_new_config(GKeyFile *key_file);
+void grid_destroy_config(GridConfig *config);
+
+#endif /* BCE4D3B8_79F9_45C2_ADFA_93A1D39EDC9A */
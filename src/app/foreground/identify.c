@@ -19,24 +19,96 @@
 
 #include "identify.h"
 
-// from an accessible find the control type
-ControlType identify_control(AtspiAccessible *accessible)
+static gboolean identify_role(AtspiRole role, ControlType *control_type);
+
+// roles of accessibles that may hold content not returned by a collection on
+// an ancestor, such as documents and embedded applications
+static const AtspiRole CONTAINER_ROLES[] = {
+    ATSPI_ROLE_EMBEDDED,
+    ATSPI_ROLE_INTERNAL_FRAME,
+    ATSPI_ROLE_DOCUMENT_FRAME,
+    ATSPI_ROLE_DOCUMENT_WEB,
+};
+
+#define NUM_CONTAINER_ROLES (sizeof(CONTAINER_ROLES) / sizeof(CONTAINER_ROLES[0]))
+
+// from an accessible find the control type, optionally giving the role it was
+// identified by
+ControlType identify_control(Bus *bus, BusObject *accessible, AtspiRole *role, GCancellable *cancellable)
 {
+    // keep the role when not wanted
+    AtspiRole role_value = ATSPI_ROLE_INVALID;
+    if (!role)
+        role = &role_value;
+    *role = ATSPI_ROLE_INVALID;
+
     // none if no accessible
     if (!accessible)
         return CONTROL_TYPE_NONE;
 
     // get control type from role
     ControlType control_type = CONTROL_TYPE_NONE;
-    switch (atspi_accessible_get_role(accessible, NULL))
+    if (!bus_get_role(bus, accessible, role, cancellable) || !identify_role(*role, &control_type))
+        return CONTROL_TYPE_NONE;
+
+    // return if known from the role alone
+    if (control_type != CONTROL_TYPE_NONE)
+        return control_type;
+
+    // check if accessible of unknown role is focusable
+    guint64 states;
+    if (!bus_get_states(bus, accessible, &states, cancellable))
+        return CONTROL_TYPE_NONE;
+    if (states & BUS_STATE(ATSPI_STATE_SELECTABLE))
+        control_type = CONTROL_TYPE_SELECTABLE;
+    else if (states & BUS_STATE(ATSPI_STATE_FOCUSABLE))
+        control_type = CONTROL_TYPE_FOCUSABLE;
+
+    // return
+    return control_type;
+}
+
+// get all the roles that may be identified as a control, used to filter
+// collections
+GArray *identify_get_roles()
+{
+    GArray *roles = g_array_new(FALSE, FALSE, sizeof(AtspiRole));
+
+    // add every role that may be a control
+    for (AtspiRole role = 0; role < ATSPI_ROLE_LAST_DEFINED; role++)
+    {
+        ControlType control_type;
+        if (identify_role(role, &control_type))
+            g_array_append_val(roles, role);
+    }
+
+    return roles;
+}
+
+// get all the roles that need to be descended into separately, used to filter
+// collections
+GArray *identify_get_container_roles()
+{
+    GArray *roles = g_array_sized_new(FALSE, FALSE, sizeof(AtspiRole), NUM_CONTAINER_ROLES);
+    g_array_append_vals(roles, CONTAINER_ROLES, NUM_CONTAINER_ROLES);
+    return roles;
+}
+
+// from a role find the control type, returns whether the role may be a control.
+// the control type is none if it depends on the accessible's states
+static gboolean identify_role(AtspiRole role, ControlType *control_type)
+{
+    *control_type = CONTROL_TYPE_NONE;
+
+    switch (role)
     {
     case ATSPI_ROLE_PAGE_TAB:
-        control_type = CONTROL_TYPE_TAB;
-        break;
+        *control_type = CONTROL_TYPE_TAB;
+        return TRUE;
 
     case ATSPI_ROLE_LINK:
-        control_type = CONTROL_TYPE_LINK;
-        break;
+        *control_type = CONTROL_TYPE_LINK;
+        return TRUE;
 
     case ATSPI_ROLE_PUSH_BUTTON:
     case ATSPI_ROLE_TOGGLE_BUTTON:
@@ -47,34 +119,23 @@ ControlType identify_control(AtspiAccessible *accessible)
     case ATSPI_ROLE_CHECK_MENU_ITEM:
     case ATSPI_ROLE_MENU:
     case ATSPI_ROLE_MENU_ITEM:
-        control_type = CONTROL_TYPE_PRESS;
-        break;
+        *control_type = CONTROL_TYPE_PRESS;
+        return TRUE;
 
     case ATSPI_ROLE_TEXT:
     case ATSPI_ROLE_ENTRY:
     case ATSPI_ROLE_PASSWORD_TEXT:
-        control_type = CONTROL_TYPE_FOCUS;
-        break;
+        *control_type = CONTROL_TYPE_FOCUS;
+        return TRUE;
 
     case ATSPI_ROLE_SECTION:
     case ATSPI_ROLE_TREE_ITEM:
     case ATSPI_ROLE_LIST_ITEM:
     case ATSPI_ROLE_TABLE_CELL:
     case ATSPI_ROLE_HEADING:
-        // check if accessible of unknown role is focusable
-        AtspiStateSet *states = atspi_accessible_get_state_set(accessible);
-        if (atspi_state_set_contains(states, ATSPI_STATE_SELECTABLE))
-            control_type = CONTROL_TYPE_SELECTABLE;
-        else if (atspi_state_set_contains(states, ATSPI_STATE_FOCUSABLE))
-            control_type = CONTROL_TYPE_FOCUSABLE;
-        g_object_unref(states);
-        break;
+        return TRUE;
 
     default:
-        control_type = CONTROL_TYPE_NONE;
-        break;
+        return FALSE;
     }
-
-    // return
-    return control_type;
 }
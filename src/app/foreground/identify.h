@@ -24,6 +24,10 @@
 
 #include "control.h"
 
-ControlType identify_control(AtspiAccessible *accessible);
+#include "../lib/bus.h"
+
+ControlType identify_control(Bus *bus, BusObject *accessible, AtspiRole *role, GCancellable *cancellable);
+GArray *identify_get_roles();
+GArray *identify_get_container_roles();
 
 #endif /* B7325ADF_09A4_4914_BE0D_C91B03468344 */
@@ -19,21 +19,16 @@
 
 #include "overlay.h"
 
-#define OVERLAY_REFRESH_INTERVAL (200)
-
 static void remove_input(GtkWidget *overlay, gpointer data);
 
-static void overlay_refresh(Overlay *overlay);
-static void overlay_reposition(Overlay *overlay);
-static gboolean overlay_refresh_loop(gpointer overlay_ptr);
 
 // creates a new overlay from the config
 Overlay *overlay_new(OverlayConfig *config)
 {
     Overlay *overlay = g_new(Overlay, 1);
 
-    // set window
-    overlay->window = NULL;
+    // set not shown
+    overlay->is_shown = FALSE;
     overlay->window_x = 0;
     overlay->window_y = 0;
 
@@ -79,38 +74,19 @@ void overlay_destroy(Overlay *overlay)
     g_free(overlay);
 }
 
-// shows the overlay on top of the window
-void overlay_show(Overlay *overlay, AtspiAccessible *window)
+// shows the overlay, it is placed once its extents are known
+void overlay_show(Overlay *overlay)
 {
-    // do nothing if invalid winow
-    if (!window || overlay->window == window)
-        return;
-
-    // hide first
-    overlay_hide(overlay);
-
-    // set the new window
-    overlay->window = g_object_ref(window);
-
-    // refresh the overlay
-    overlay_refresh(overlay);
-
-    // start the refresh loop
-    overlay->refresh_source_id = g_timeout_add(OVERLAY_REFRESH_INTERVAL,
-                                               overlay_refresh_loop,
-                                               overlay);
+    overlay->is_shown = TRUE;
 }
 
-// hides the overlay and unsets the followed window
+// hides the overlay
 void overlay_hide(Overlay *overlay)
 {
-    // do nothing if no window
-    if (!overlay->window)
+    // do nothing if not shown
+    if (!overlay->is_shown)
         return;
-
-    // remove the old window
-    g_object_unref(overlay->window);
-    overlay->window = NULL;
+    overlay->is_shown = FALSE;
 
     // hide all tags
     GHashTableIter iter;
@@ -121,9 +97,32 @@ void overlay_hide(Overlay *overlay)
 
     // hide the overlay
     gtk_widget_hide(overlay->overlay);
+}
+
+// moves the overlay over the given screen extents
+void overlay_move(Overlay *overlay, AtspiRect extents)
+{
+    // do nothing if not shown
+    if (!overlay->is_shown)
+        return;
 
-    // remove idle refresh
-    g_source_remove(overlay->refresh_source_id);
+    // save coordinates
+    overlay->window_x = extents.x;
+    overlay->window_y = extents.y;
+
+    // move the window
+    gtk_window_move(GTK_WINDOW(overlay->overlay), extents.x, extents.y);
+    gtk_window_resize(GTK_WINDOW(overlay->overlay), extents.width, extents.height);
+
+    // reshow the tags
+    GHashTableIter iter;
+    gpointer tag_ptr, null_ptr;
+    g_hash_table_iter_init(&iter, overlay->tags);
+    while (g_hash_table_iter_next(&iter, &tag_ptr, &null_ptr))
+        tag_show(tag_ptr, GTK_LAYOUT(overlay->container), overlay->window_x, overlay->window_y);
+
+    // show the window
+    gtk_widget_show_all(overlay->overlay);
 }
 
 // adds a tag to the overlay
@@ -138,7 +137,7 @@ void overlay_add(Overlay *overlay, Tag *tag)
     tag_shifted(tag, overlay->shifted);
 
     // show tag if overlay is shown
-    if (overlay->window)
+    if (overlay->is_shown)
         tag_show(tag, GTK_LAYOUT(overlay->container), overlay->window_x, overlay->window_y);
 }
 
@@ -151,7 +150,7 @@ void overlay_remove(Overlay *overlay, Tag *tag)
         return;
 
     // hide tag from overlay if shown
-    if (overlay->window)
+    if (overlay->is_shown)
         tag_hide(tag);
 }
 
@@ -184,61 +183,3 @@ static void remove_input(GtkWidget *overlay, gpointer data)
     gdk_window_input_shape_combine_region(gtk_widget_get_window(overlay), region, 0, 0);
     cairo_region_destroy(region);
 }
-
-// repositions the overlay window and all its tags
-static void overlay_refresh(Overlay *overlay)
-{
-    // do nothing if not shown
-    if (!overlay->window)
-        return;
-
-    // reposition the overlay
-    overlay_reposition(overlay);
-
-    // reshow the tags the tags
-    GHashTableIter iter;
-    gpointer tag_ptr, null_ptr;
-    g_hash_table_iter_init(&iter, overlay->tags);
-    while (g_hash_table_iter_next(&iter, &tag_ptr, &null_ptr))
-        tag_show(tag_ptr, GTK_LAYOUT(overlay->container), overlay->window_x, overlay->window_y);
-
-    // show the window
-    gtk_widget_show_all(overlay->overlay);
-}
-
-// repositions the overlay over the followed window
-static void overlay_reposition(Overlay *overlay)
-{
-    // get window dimensions
-    AtspiComponent *component = atspi_accessible_get_component_iface(overlay->window);
-    AtspiRect *rect = atspi_component_get_extents(component, ATSPI_COORD_TYPE_SCREEN, NULL);
-
-    // save coordinates
-    overlay->window_x = rect->x;
-    overlay->window_y = rect->y;
-
-    // move the window
-    gtk_window_move(GTK_WINDOW(overlay->overlay), rect->x, rect->y);
-    gtk_window_resize(GTK_WINDOW(overlay->overlay), rect->width, rect->height);
-
-    // free
-    g_object_unref(component);
-    g_free(rect);
-}
-
-// refreshes the overlay every interval
-static gboolean overlay_refresh_loop(gpointer overlay_ptr)
-{
-    Overlay *overlay = overlay_ptr;
-
-    // refresh the overlay
-    overlay_refresh(overlay);
-
-    // add a source to call in a bit
-    overlay->refresh_source_id = g_timeout_add(OVERLAY_REFRESH_INTERVAL,
-                                               overlay_refresh_loop,
-                                               overlay);
-
-    // remove this source
-    return G_SOURCE_REMOVE;
-}
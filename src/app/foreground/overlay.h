@@ -30,10 +30,10 @@
 
 #define OVERLAY_WINDOW_TITLE "goodnight_mouse"
 
-// overlay window that can hold tags and show over a given window
+// overlay window that can hold tags and show over a given screen area
 typedef struct Overlay
 {
-    AtspiAccessible *window;
+    gboolean is_shown;
     gint window_x;
     gint window_y;
 
@@ -42,14 +42,13 @@ typedef struct Overlay
 
     GtkWidget *overlay;
     GtkWidget *container;
-
-    guint refresh_source_id;
 } Overlay;
 
 Overlay *overlay_new(OverlayConfig *config);
 void overlay_destroy(Overlay *overlay);
-void overlay_show(Overlay *overlay, AtspiAccessible *window);
+void overlay_show(Overlay *overlay);
 void overlay_hide(Overlay *overlay);
+void overlay_move(Overlay *overlay, AtspiRect extents);
 void overlay_add(Overlay *overlay, Tag *tag);
 void overlay_remove(Overlay *overlay, Tag *tag);
 void overlay_shifted(Overlay *overlay, gboolean shifted);
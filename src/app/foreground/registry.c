@@ -22,18 +22,39 @@
 #include <gsl/gsl_qrng.h>
 
 #include "identify.h"
+#include "../lib/worker.h"
 
 #define REGISTRY_REFRESH_INTERVAL (200)
-#define REGISTRY_REFRESH_BATCHES (10)
+#define REGISTRY_PAGE_SIZE (100)
+#define REGISTRY_REGION_DEPTH (32)
 
 static gboolean registry_refresh_source_start(gpointer registry_ptr);
-static gboolean registry_refresh_source_run(gpointer registry_ptr);
+static gboolean registry_refresh_run(gpointer registry_ptr);
 static void registry_refresh_iterate(Registry *registry);
 static void registry_refresh_finish(Registry *registry);
+static void registry_refresh_stop(Registry *registry);
+static BusObject *registry_refresh_root(Registry *registry);
 
 static gboolean registry_check_children(Registry *registry, ControlType control_type);
-static GList *registry_get_children(Registry *registry, AtspiAccessible *accessible);
-static GList *registry_get_children_fallback(Registry *registry, AtspiAccessible *accessible);
+static GList *registry_get_children(Registry *registry, BusObject *accessible);
+static GList *registry_get_children_fallback(Registry *registry, BusObject *accessible);
+static void registry_skip_descendants(Registry *registry, BusObject *accessible);
+static void registry_fetch_page(Registry *registry);
+
+static gboolean registry_apply(gpointer registry_ptr);
+static void registry_apply_snapshot(Registry *registry, RegistrySnapshot *snapshot);
+static gboolean registry_apply_render(gpointer registry_ptr);
+static gboolean registry_apply_reposition(gpointer registry_ptr);
+static void registry_apply_retire(Registry *registry);
+static gboolean registry_extents_equal(AtspiRect *extents, AtspiRect *other_extents);
+static gboolean registry_extents_intersect(AtspiRect *extents, AtspiRect *other_extents);
+static gboolean registry_extents_contain(AtspiRect *extents, AtspiRect *other_extents);
+
+static RegistryEntry *registry_entry_new(Registry *registry, BusObject *accessible, ControlType control_type, AtspiRect *extents);
+static void registry_entry_free(gpointer entry_ptr);
+static void registry_snapshot_free(RegistrySnapshot *snapshot);
+static RegistryPage *registry_page_new(BusObject *collection, GVariant *rule, gboolean covers, gboolean skips);
+static void registry_page_free(gpointer page_ptr);
 
 static const AtspiStateType INTERACTIVE_STATES[] = {
     ATSPI_STATE_SHOWING,
@@ -45,31 +66,60 @@ static const AtspiStateType INTERACTIVE_STATES[] = {
 #define NUM_INTERACTIVE_STATES (sizeof(INTERACTIVE_STATES) / sizeof(INTERACTIVE_STATES[0]))
 
 // create a new registry
-Registry *registry_new()
+Registry *registry_new(Bus *bus, Scheduler *scheduler)
 {
     Registry *registry = g_new(Registry, 1);
 
-    // init members
-    registry->accessibles = g_hash_table_new_full(NULL, NULL, g_object_unref, NULL);
-
-    // create match rule
-    AtspiStateSet *interactive_states = atspi_state_set_new(NULL);
-    for (gint index = 0; index < NUM_INTERACTIVE_STATES; index++)
-        atspi_state_set_add(interactive_states, INTERACTIVE_STATES[index]);
-    registry->match_interactive = atspi_match_rule_new(interactive_states, ATSPI_Collection_MATCH_ALL,
-                                                       NULL, ATSPI_Collection_MATCH_NONE,
-                                                       NULL, ATSPI_Collection_MATCH_NONE,
-                                                       NULL, ATSPI_Collection_MATCH_NONE,
-                                                       FALSE);
-    g_object_unref(interactive_states);
+    // add dependencies
+    registry->bus = bus;
+    registry->scheduler = scheduler;
 
     // set not watching
     registry->window = NULL;
 
+    // init the applied snapshot
+    registry->front = NULL;
+    registry->retired = g_ptr_array_new_with_free_func((GDestroyNotify)registry_snapshot_free);
+    registry->accessibles = g_hash_table_new(bus_object_hash, bus_object_equal);
+    registry->apply_source_id = 0;
+
+    // init the pending changes
+    registry->render_task_id = 0;
+    registry->reposition_task_id = 0;
+    registry->entries_to_remove = g_queue_new();
+    registry->entries_to_add = g_queue_new();
+    registry->entries_to_move = g_queue_new();
+    registry->window_to_move = FALSE;
+
+    // init the published snapshot
+    g_mutex_init(&registry->mutex);
+    registry->back = NULL;
+
+    // create match rules, filtering roles on the toolkit side
+    guint64 interactive_states = 0;
+    for (gint index = 0; index < NUM_INTERACTIVE_STATES; index++)
+        interactive_states |= BUS_STATE(INTERACTIVE_STATES[index]);
+    GArray *interactive_roles = identify_get_roles();
+    GArray *container_roles = identify_get_container_roles();
+    registry->match_interactive = bus_match_rule_new(interactive_states, ATSPI_Collection_MATCH_ALL,
+                                                     interactive_roles, ATSPI_Collection_MATCH_ANY);
+    registry->match_container = bus_match_rule_new(interactive_states, ATSPI_Collection_MATCH_ALL,
+                                                   container_roles, ATSPI_Collection_MATCH_ANY);
+    g_array_unref(interactive_roles);
+    g_array_unref(container_roles);
+
     // init refresh iterator
+    registry->cancellable = g_cancellable_new();
+    registry->refresh_window = NULL;
+    registry->refresh_has_region = FALSE;
+    registry->refresh_root = NULL;
+    registry->refresh_source_id = 0;
+    registry->refresh_task_id = 0;
     registry->accessibles_to_process = NULL;
-    registry->accessibles_to_keep = g_hash_table_new_full(NULL, NULL, g_object_unref, NULL);
-    registry->accessibles_to_add = g_ptr_array_new_with_free_func(g_object_unref);
+    registry->pages_to_fetch = NULL;
+    registry->accessibles_to_keep = g_hash_table_new_full(bus_object_hash, bus_object_equal, bus_object_free, NULL);
+    registry->accessibles_covered = g_hash_table_new_full(bus_object_hash, bus_object_equal, bus_object_free, NULL);
+    registry->entries_to_publish = g_ptr_array_new_with_free_func(registry_entry_free);
 
     return registry;
 }
@@ -80,22 +130,31 @@ void registry_destroy(Registry *registry)
     // unwatch
     registry_unwatch(registry);
 
-    // free members
+    // free snapshots
     g_hash_table_unref(registry->accessibles);
-    g_object_unref(registry->match_interactive);
+    g_ptr_array_unref(registry->retired);
+    g_mutex_clear(&registry->mutex);
+
+    // free the pending changes
+    g_queue_free(registry->entries_to_remove);
+    g_queue_free(registry->entries_to_add);
+    g_queue_free(registry->entries_to_move);
 
     // free refresh iterator
-    g_list_free_full(registry->accessibles_to_process, g_object_unref);
-    registry->accessibles_to_process = NULL;
+    g_object_unref(registry->cancellable);
+    g_variant_unref(registry->match_interactive);
+    g_variant_unref(registry->match_container);
     g_hash_table_unref(registry->accessibles_to_keep);
-    g_ptr_array_unref(registry->accessibles_to_add);
+    g_hash_table_unref(registry->accessibles_covered);
+    g_ptr_array_unref(registry->entries_to_publish);
 
     // free registry
     g_free(registry);
 }
 
-// watch a specific window
-void registry_watch(Registry *registry, AtspiAccessible *window, RegistrySubscriber subscriber)
+// watch a specific window, only crawling the accessibles within a region of the
+// screen if one is given
+void registry_watch(Registry *registry, AtspiAccessible *window, AtspiRect *region, RegistrySubscriber subscriber)
 {
     // unwatch first
     registry_unwatch(registry);
@@ -108,8 +167,15 @@ void registry_watch(Registry *registry, AtspiAccessible *window, RegistrySubscri
     registry->window = g_object_ref(window);
     registry->subscriber = subscriber;
 
-    // start the refresh loop
-    registry_refresh_source_start(registry);
+    // start the refresh loop on the worker thread
+    worker_lock();
+    registry->refresh_window = bus_object_new_for_accessible(window);
+    registry->refresh_has_region = region != NULL;
+    if (region)
+        registry->refresh_region = *region;
+    if (registry->refresh_window)
+        registry_refresh_source_start(registry);
+    worker_unlock();
 }
 
 // stop the registry from watching anything
@@ -119,96 +185,175 @@ void registry_unwatch(Registry *registry)
     if (!registry->window)
         return;
 
-    // dereference window
+    // abort any call in flight, so the worker gives up the lock right away
+    g_cancellable_cancel(registry->cancellable);
+
+    // stop the refresh loop, holding the lock means it is not running
+    worker_lock();
+    registry_refresh_stop(registry);
+    g_object_unref(registry->cancellable);
+    registry->cancellable = g_cancellable_new();
+
+    // dereference window, the atspi cache is shared with the worker
     g_object_unref(registry->window);
     registry->window = NULL;
+    worker_unlock();
+
+    // drop the published snapshot
+    g_mutex_lock(&registry->mutex);
+    if (registry->apply_source_id)
+        g_source_remove(registry->apply_source_id);
+    registry->apply_source_id = 0;
+    if (registry->back)
+        registry_snapshot_free(registry->back);
+    registry->back = NULL;
+    g_mutex_unlock(&registry->mutex);
+
+    // drop the pending changes, accessibles waiting to be removed are still applied
+    if (registry->render_task_id)
+        scheduler_remove(registry->scheduler, registry->render_task_id);
+    registry->render_task_id = 0;
+    if (registry->reposition_task_id)
+        scheduler_remove(registry->scheduler, registry->reposition_task_id);
+    registry->reposition_task_id = 0;
+    g_queue_clear(registry->entries_to_remove);
+    g_queue_clear(registry->entries_to_add);
+    g_queue_clear(registry->entries_to_move);
+    registry->window_to_move = FALSE;
 
     // remove all controls
     GHashTableIter iter;
-    gpointer accessible_ptr, null_ptr;
+    gpointer accessible_ptr, entry_ptr;
     g_hash_table_iter_init(&iter, registry->accessibles);
-    while (g_hash_table_iter_next(&iter, &accessible_ptr, &null_ptr))
+    while (g_hash_table_iter_next(&iter, &accessible_ptr, &entry_ptr))
     {
         if (registry->subscriber.remove)
-            registry->subscriber.remove(accessible_ptr, registry->subscriber.data);
+            registry->subscriber.remove(entry_ptr, registry->subscriber.data);
         g_hash_table_iter_remove(&iter);
     }
 
-    // stop the refresh iterator
-    g_source_remove(registry->refresh_source_id);
-    g_list_free_full(registry->accessibles_to_process, g_object_unref);
-    registry->accessibles_to_process = NULL;
-    g_hash_table_remove_all(registry->accessibles_to_keep);
-    g_ptr_array_remove_range(registry->accessibles_to_add, 0, registry->accessibles_to_add->len);
+    // free the applied snapshots
+    registry_apply_retire(registry);
+    if (registry->front)
+        registry_snapshot_free(registry->front);
+    registry->front = NULL;
 }
 
-// start a refresh loop
+// start a refresh loop, run on the worker thread
 static gboolean registry_refresh_source_start(gpointer registry_ptr)
 {
     Registry *registry = registry_ptr;
 
-    // add the refresh source
-    registry->refresh_source_id = g_idle_add_full(G_PRIORITY_DEFAULT_IDLE,
-                                                  registry_refresh_source_run,
-                                                  registry,
-                                                  NULL);
+    // schedule the crawl, sliced to fit the frames of the worker
+    registry->refresh_source_id = 0;
+    registry->refresh_task_id = scheduler_add(worker_get_scheduler(), SCHEDULER_PRIORITY_CRAWL, registry_refresh_run, registry);
 
     // remove this source
     return G_SOURCE_REMOVE;
 }
 
-// run a refresh loop
-static gboolean registry_refresh_source_run(gpointer registry_ptr)
+// run a slice of a refresh loop, returns whether there is more to crawl
+static gboolean registry_refresh_run(gpointer registry_ptr)
 {
     Registry *registry = registry_ptr;
 
-    // start with the window if there are no accessibles to process
-    if (registry->accessibles_to_process == NULL)
-        registry->accessibles_to_process = g_list_append(registry->accessibles_to_process, g_object_ref(registry->window));
+    // stop if cancelled, the refresh is being stopped
+    if (g_cancellable_is_cancelled(registry->cancellable))
+    {
+        registry->refresh_task_id = 0;
+        return FALSE;
+    }
+
+    // start with the window, or the part of it holding the region, if there is nothing to process
+    if (registry->accessibles_to_process == NULL && registry->pages_to_fetch == NULL)
+    {
+        if (!registry->refresh_root)
+            registry->refresh_root = registry_refresh_root(registry);
+        registry->accessibles_to_process = g_list_append(registry->accessibles_to_process, bus_object_copy(registry->refresh_root));
+    }
 
-    // run a batch of iterations
-    for (gint count = 0; count < REGISTRY_REFRESH_BATCHES; count++)
-        registry_refresh_iterate(registry);
+    // run an iteration, the scheduler yields once the frame budget is spent
+    registry_refresh_iterate(registry);
 
     // continue if there are more items to process
-    if (registry->accessibles_to_process != NULL)
-        return G_SOURCE_CONTINUE;
+    if (registry->accessibles_to_process != NULL || registry->pages_to_fetch != NULL)
+        return TRUE;
 
     // finalize this refresh
     registry_refresh_finish(registry);
 
     // add the timeout source
-    registry->refresh_source_id = g_timeout_add(REGISTRY_REFRESH_INTERVAL, registry_refresh_source_start, registry);
+    GSource *source = g_timeout_source_new(REGISTRY_REFRESH_INTERVAL);
+    g_source_set_callback(source, registry_refresh_source_start, registry, NULL);
+    registry->refresh_source_id = worker_add_source(source);
 
-    // remove this source
-    return G_SOURCE_REMOVE;
+    // finish this task
+    registry->refresh_task_id = 0;
+    return FALSE;
 }
 
 // run a single iteration of the refresh loop
 static void registry_refresh_iterate(Registry *registry)
 {
-    // ensure there are accessibles to process
-    if (registry->accessibles_to_process == NULL)
+    // fetch the next page once the accessibles found so far are processed, or
+    // right away if it marks accessibles to skip before they are processed
+    if (registry->accessibles_to_process == NULL ||
+        (registry->pages_to_fetch != NULL && ((RegistryPage *)registry->pages_to_fetch->data)->skips))
+    {
+        if (registry->pages_to_fetch != NULL)
+            registry_fetch_page(registry);
         return;
+    }
 
     // pop first accessible to check
-    AtspiAccessible *accessible = registry->accessibles_to_process->data;
+    BusObject *accessible = registry->accessibles_to_process->data;
     registry->accessibles_to_process = g_list_delete_link(registry->accessibles_to_process, registry->accessibles_to_process);
 
-    // mark as processed (steals the reference) and don't process again
-    if (!g_hash_table_add(registry->accessibles_to_keep, accessible))
+    // don't process again
+    if (g_hash_table_contains(registry->accessibles_to_keep, accessible))
+    {
+        bus_object_free(accessible);
         return;
+    }
+
+    // mark as processed (steals the reference)
+    g_hash_table_add(registry->accessibles_to_keep, accessible);
+
+    // prune accessibles outside of the region along with their descendants,
+    // keeping the extents for the entry
+    AtspiRect extents;
+    gboolean has_extents = FALSE;
+    if (registry->refresh_has_region)
+    {
+        if (!bus_get_extents(registry->bus, accessible, &extents, registry->cancellable) ||
+            !registry_extents_intersect(&extents, &registry->refresh_region))
+            return;
+        has_extents = TRUE;
+    }
 
     // identify the accessible
-    ControlType control_type = identify_control(accessible);
+    AtspiRole role;
+    ControlType control_type = identify_control(registry->bus, accessible, &role, registry->cancellable);
+
+    // a collection result already holds the whole subtree of covered accessibles,
+    // except under an embedded accessible that another application plugs into
+    gboolean covered = g_hash_table_contains(registry->accessibles_covered, accessible) &&
+                       role != ATSPI_ROLE_EMBEDDED;
 
     // add the children to the front
     if (registry_check_children(registry, control_type))
-        registry->accessibles_to_process = g_list_concat(registry_get_children(registry, accessible), registry->accessibles_to_process);
-
-    // mark to add if it is a valid control and does not already exist
-    if (control_type != CONTROL_TYPE_NONE && !g_hash_table_contains(registry->accessibles, accessible))
-        g_ptr_array_add(registry->accessibles_to_add, g_object_ref(accessible));
+    {
+        if (!covered)
+            registry->accessibles_to_process = g_list_concat(registry_get_children(registry, accessible), registry->accessibles_to_process);
+    }
+    // skip the descendants already queued by a collection result
+    else if (covered)
+        registry_skip_descendants(registry, accessible);
+
+    // record it if it is a valid control
+    if (control_type != CONTROL_TYPE_NONE)
+        g_ptr_array_add(registry->entries_to_publish, registry_entry_new(registry, accessible, control_type,
+                                                                         has_extents ? &extents : NULL));
 }
 
 // get whether to check the child accessibles of this control type
@@ -224,93 +369,288 @@ static gboolean registry_check_children(Registry *registry, ControlType control_
     }
 }
 
-// get all the children of an accessible
-static GList *registry_get_children(Registry *registry, AtspiAccessible *accessible)
+// get all the children of an accessible, using a collection where supported.
+// a collection returns all matching descendants, so the controls are marked as
+// covered and not descended into again. containers of another application hold
+// content the collection could not return, so they are followed after the
+// controls. the matches are fetched in pages later, so no children are returned directly.
+// within a region the children are iterated instead, so the subtrees outside
+// of it are pruned rather than returned by the collection
+static GList *registry_get_children(Registry *registry, BusObject *accessible)
 {
-    GList *children = NULL;
-
-    // get collection
-    AtspiCollection *collection = atspi_accessible_get_collection_iface(accessible);
-    if (!collection)
+    // descend one level at a time within a region
+    if (registry->refresh_has_region)
         return registry_get_children_fallback(registry, accessible);
 
-    // get interactive children
-    GArray *array = atspi_collection_get_matches(collection,
-                                                 registry->match_interactive,
-                                                 ATSPI_Collection_SORT_ORDER_CANONICAL,
-                                                 0, FALSE, NULL);
-    if (!array)
-        return children;
-
-    // convert to linked list
-    for (gint index = 0; index < array->len; index++)
-        children = g_list_append(children, g_array_index(array, AtspiAccessible *, index));
+    // check for collection support
+    if (!bus_has_interface(registry->bus, accessible, ATSPI_DBUS_INTERFACE_COLLECTION, registry->cancellable))
+        return registry_get_children_fallback(registry, accessible);
 
-    // clean up
-    g_array_unref(array);
-    g_object_unref(collection);
+    // add the cursors to the front, interactive descendants first
+    registry->pages_to_fetch = g_list_prepend(registry->pages_to_fetch, registry_page_new(accessible, registry->match_container, FALSE, FALSE));
+    registry->pages_to_fetch = g_list_prepend(registry->pages_to_fetch, registry_page_new(accessible, registry->match_interactive, TRUE, FALSE));
 
-    // return
-    return children;
+    return NULL;
 }
 
 // get all the children of an accessible by iteration, not collections
-static GList *registry_get_children_fallback(Registry *registry, AtspiAccessible *accessible)
+static GList *registry_get_children_fallback(Registry *registry, BusObject *accessible)
 {
     GList *children = NULL;
 
+    // get the interactive state mask
+    guint64 interactive_states = 0;
+    for (gint index = 0; index < NUM_INTERACTIVE_STATES; index++)
+        interactive_states |= BUS_STATE(INTERACTIVE_STATES[index]);
+
     // check all the children manually
-    for (gint index = 0; index < atspi_accessible_get_child_count(accessible, NULL); index++)
+    GPtrArray *array = bus_get_children(registry->bus, accessible, registry->cancellable);
+    for (gint index = 0; index < array->len; index++)
     {
-        AtspiAccessible *child = atspi_accessible_get_child_at_index(accessible, index, NULL);
-        if (!child)
-            continue;
+        BusObject *child = g_ptr_array_index(array, index);
 
         // check if is interactive
-        AtspiStateSet *state_set = atspi_accessible_get_state_set(child);
-        gboolean is_interactive = TRUE;
-        for (gint index = 0; index < NUM_INTERACTIVE_STATES; index++)
-            is_interactive &= atspi_state_set_contains(state_set, INTERACTIVE_STATES[index]);
-        g_object_unref(state_set);
+        guint64 states;
+        gboolean is_interactive = bus_get_states(registry->bus, child, &states, registry->cancellable) &&
+                                  (states & interactive_states) == interactive_states;
 
         // add the child if it is interactive
         if (is_interactive)
-            children = g_list_append(children, child);
-        else
-            g_object_unref(child);
+            children = g_list_prepend(children, bus_object_copy(child));
+    }
+    g_ptr_array_unref(array);
+
+    return g_list_reverse(children);
+}
+
+// mark all the descendants of an accessible as processed so they are skipped. the
+// descendants queued by the collection result are fetched a page at a time by
+// cursors ahead of the accessibles to process
+static void registry_skip_descendants(Registry *registry, BusObject *accessible)
+{
+    // check for collection support
+    if (!bus_has_interface(registry->bus, accessible, ATSPI_DBUS_INTERFACE_COLLECTION, registry->cancellable))
+        return;
+
+    // add the cursors to the front
+    registry->pages_to_fetch = g_list_prepend(registry->pages_to_fetch, registry_page_new(accessible, registry->match_container, FALSE, TRUE));
+    registry->pages_to_fetch = g_list_prepend(registry->pages_to_fetch, registry_page_new(accessible, registry->match_interactive, FALSE, TRUE));
+}
+
+// fetch the next page of matches from the first cursor and add them to the front,
+// or mark them as processed if the cursor skips them
+static void registry_fetch_page(Registry *registry)
+{
+    RegistryPage *page = registry->pages_to_fetch->data;
+
+    // get the page, the cursor may be freed below
+    GPtrArray *array = bus_get_matches(registry->bus, page->collection, page->rule, page->last, REGISTRY_PAGE_SIZE, registry->cancellable);
+    gboolean covers = page->covers;
+    gboolean skips = page->skips;
+    gchar *bus_name = g_strdup(page->collection->bus_name);
+
+    // continue from the last match if the page was full, otherwise remove the cursor
+    guint length = array->len;
+    if (length == REGISTRY_PAGE_SIZE)
+    {
+        if (page->last)
+            bus_object_free(page->last);
+        page->last = bus_object_copy(g_ptr_array_index(array, length - 1));
+    }
+    else
+    {
+        registry_page_free(page);
+        registry->pages_to_fetch = g_list_delete_link(registry->pages_to_fetch, registry->pages_to_fetch);
+    }
+
+    // mark as processed (steals the references)
+    if (skips)
+    {
+        for (gint index = 0; index < array->len; index++)
+            g_hash_table_add(registry->accessibles_to_keep, g_ptr_array_index(array, index));
+        g_free(g_ptr_array_free(array, FALSE));
+        g_free(bus_name);
+        return;
     }
 
-    return children;
+    // convert to linked list and mark as covered, containers of the same
+    // application had their subtree returned with the controls already
+    GList *children = NULL;
+    for (gint index = 0; index < array->len; index++)
+    {
+        BusObject *child = g_ptr_array_index(array, index);
+        if (covers || g_strcmp0(child->bus_name, bus_name) == 0)
+            g_hash_table_add(registry->accessibles_covered, bus_object_copy(child));
+        children = g_list_prepend(children, child);
+    }
+    g_free(g_ptr_array_free(array, FALSE));
+    g_free(bus_name);
+
+    // add in order to the front
+    registry->accessibles_to_process = g_list_concat(g_list_reverse(children), registry->accessibles_to_process);
 }
 
-// finalize the results of a refresh
+// finalize the results of a refresh by publishing them to the main thread
 static void registry_refresh_finish(Registry *registry)
 {
-    // remove any accessibles not found
+    g_hash_table_remove_all(registry->accessibles_to_keep);
+    g_hash_table_remove_all(registry->accessibles_covered);
+
+    // find the root again next time if nothing was found under it, it may be gone
+    if (registry->entries_to_publish->len == 0)
+        g_clear_pointer(&registry->refresh_root, bus_object_free);
+
+    // create the snapshot, taking the entries found
+    RegistrySnapshot *snapshot = g_new(RegistrySnapshot, 1);
+    snapshot->window.accessible = bus_object_copy(registry->refresh_window);
+    snapshot->window.control_type = CONTROL_TYPE_NONE;
+    if (!bus_get_extents(registry->bus, registry->refresh_window, &snapshot->window.extents, registry->cancellable))
+        snapshot->window.extents = (AtspiRect){0, 0, 0, 0};
+    snapshot->entries = registry->entries_to_publish;
+    registry->entries_to_publish = g_ptr_array_new_with_free_func(registry_entry_free);
+
+    // replace the published snapshot, it is dropped if the main thread did not get to it
+    g_mutex_lock(&registry->mutex);
+    if (registry->back)
+        registry_snapshot_free(registry->back);
+    registry->back = snapshot;
+    if (!registry->apply_source_id)
+        registry->apply_source_id = g_idle_add(registry_apply, registry);
+    g_mutex_unlock(&registry->mutex);
+}
+
+// stop the refresh loop and clear its state
+static void registry_refresh_stop(Registry *registry)
+{
+    // remove the source or task, whichever is pending
+    if (registry->refresh_source_id)
+        worker_remove_source(registry->refresh_source_id);
+    registry->refresh_source_id = 0;
+    if (registry->refresh_task_id)
+        scheduler_remove(worker_get_scheduler(), registry->refresh_task_id);
+    registry->refresh_task_id = 0;
+
+    // clear the iterator
+    g_list_free_full(registry->accessibles_to_process, bus_object_free);
+    registry->accessibles_to_process = NULL;
+    g_list_free_full(registry->pages_to_fetch, registry_page_free);
+    registry->pages_to_fetch = NULL;
+    g_hash_table_remove_all(registry->accessibles_to_keep);
+    g_hash_table_remove_all(registry->accessibles_covered);
+    g_ptr_array_remove_range(registry->entries_to_publish, 0, registry->entries_to_publish->len);
+
+    // free the root and window
+    g_clear_pointer(&registry->refresh_root, bus_object_free);
+    if (registry->refresh_window)
+        bus_object_free(registry->refresh_window);
+    registry->refresh_window = NULL;
+}
+
+// get the accessible to start a refresh from. with a region, this descends from
+// the window through the children at the region's center for as long as they
+// hold the whole region, so only that part of the window is crawled. it is kept
+// across refreshes of the same watch
+static BusObject *registry_refresh_root(Registry *registry)
+{
+    BusObject *root = bus_object_copy(registry->refresh_window);
+    if (!registry->refresh_has_region)
+        return root;
+
+    // get the center of the region
+    AtspiRect *region = &registry->refresh_region;
+    gint x = region->x + region->width / 2;
+    gint y = region->y + region->height / 2;
+
+    // descend while the child at the center covers the region
+    for (gint depth = 0; depth < REGISTRY_REGION_DEPTH; depth++)
+    {
+        BusObject *child = bus_get_accessible_at_point(registry->bus, root, x, y, registry->cancellable);
+        if (!child)
+            break;
+
+        // stop at a child not holding the whole region, or the same accessible
+        AtspiRect extents;
+        if (bus_object_equal(child, root) ||
+            !bus_get_extents(registry->bus, child, &extents, registry->cancellable) ||
+            !registry_extents_contain(&extents, region))
+        {
+            bus_object_free(child);
+            break;
+        }
+
+        bus_object_free(root);
+        root = child;
+    }
+
+    return root;
+}
+
+// apply the latest published snapshot on the main thread
+static gboolean registry_apply(gpointer registry_ptr)
+{
+    Registry *registry = registry_ptr;
+
+    // take the published snapshot
+    g_mutex_lock(&registry->mutex);
+    RegistrySnapshot *snapshot = registry->back;
+    registry->back = NULL;
+    registry->apply_source_id = 0;
+    g_mutex_unlock(&registry->mutex);
+
+    // apply it
+    if (snapshot)
+        registry_apply_snapshot(registry, snapshot);
+
+    // remove this source
+    return G_SOURCE_REMOVE;
+}
+
+// diff a snapshot against the applied one and schedule the changes for the subscriber.
+// the changes still queued from the previous snapshot are replaced, so additions
+// and moves of accessibles no longer found are dropped without being applied
+static void registry_apply_snapshot(Registry *registry, RegistrySnapshot *snapshot)
+{
+    // index the new snapshot
+    GHashTable *accessibles = g_hash_table_new(bus_object_hash, bus_object_equal);
+    for (guint index = 0; index < snapshot->entries->len; index++)
+    {
+        RegistryEntry *entry = g_ptr_array_index(snapshot->entries, index);
+        g_hash_table_insert(accessibles, entry->accessible, entry);
+    }
+
+    // keep the moves the subscriber has not had yet, the applied entries already have the extents
+    GHashTable *accessibles_to_move = g_hash_table_new(bus_object_hash, bus_object_equal);
+    for (GList *link = registry->entries_to_move->head; link; link = link->next)
+        g_hash_table_add(accessibles_to_move, ((RegistryEntry *)link->data)->accessible);
+
+    // drop the queued changes, they are queued again below if still needed
+    g_queue_clear(registry->entries_to_remove);
+    g_queue_clear(registry->entries_to_add);
+    g_queue_clear(registry->entries_to_move);
+
+    // queue removing any accessibles not found, they stay applied until removed
     GHashTableIter iter;
-    gpointer accessible_ptr, null_ptr;
+    gpointer accessible_ptr, entry_ptr;
     g_hash_table_iter_init(&iter, registry->accessibles);
-    while (g_hash_table_iter_next(&iter, &accessible_ptr, &null_ptr))
+    while (g_hash_table_iter_next(&iter, &accessible_ptr, &entry_ptr))
     {
-        // do nothing if found
-        if (g_hash_table_contains(registry->accessibles_to_keep, accessible_ptr))
-            continue;
-
-        // remove if not found
-        if (registry->subscriber.remove)
-            registry->subscriber.remove(accessible_ptr, registry->subscriber.data);
-        g_hash_table_iter_remove(&iter);
+        if (!g_hash_table_contains(accessibles, accessible_ptr))
+            g_queue_push_tail(registry->entries_to_remove, entry_ptr);
     }
-    g_hash_table_remove_all(registry->accessibles_to_keep);
+    g_hash_table_unref(accessibles);
+
+    // queue moving the window
+    registry->window_to_move = registry->window_to_move || !registry->front ||
+                               !registry_extents_equal(&registry->front->window.extents, &snapshot->window.extents);
 
-    // add all the new accessibles
+    // queue adding all the new accessibles and moving the existing ones
     // create a quasi-random number generator
     gsl_qrng *generator = gsl_qrng_alloc(gsl_qrng_halton, 1);
     // the lowest power of 2 greater than the number of accessibles multiplied
     // by the generated value will be a unique, whole integer that can be used
     // as an index, with the exception of 0 being 0.5
     gint multiplier = 1;
-    while (multiplier < registry->accessibles_to_add->len)
+    while (multiplier < snapshot->entries->len)
         multiplier *= 2;
 
     // iterate through all the indexes
@@ -321,19 +661,195 @@ static void registry_refresh_finish(Registry *registry)
 
         // get index from generator
         gint index = (gint)(value * multiplier);
-        if (index >= registry->accessibles_to_add->len)
+        if (index >= snapshot->entries->len)
             continue;
 
-        // get accessible
-        AtspiAccessible *accessible = g_ptr_array_index(registry->accessibles_to_add, index);
+        // get entry
+        RegistryEntry *entry = g_ptr_array_index(snapshot->entries, index);
+        RegistryEntry *applied_entry = g_hash_table_lookup(registry->accessibles, entry->accessible);
 
         // add accessible
-        g_hash_table_add(registry->accessibles, g_object_ref(accessible));
-        if (registry->subscriber.add)
-            registry->subscriber.add(accessible, registry->subscriber.data);
+        if (!applied_entry)
+        {
+            g_queue_push_tail(registry->entries_to_add, entry);
+            continue;
+        }
+
+        // point the applied accessible at the new entry, and move it if needed
+        gboolean moved = !registry_extents_equal(&applied_entry->extents, &entry->extents) ||
+                         g_hash_table_contains(accessibles_to_move, entry->accessible);
+        g_hash_table_replace(registry->accessibles, entry->accessible, entry);
+        if (moved)
+            g_queue_push_tail(registry->entries_to_move, entry);
     }
-    g_ptr_array_remove_range(registry->accessibles_to_add, 0, registry->accessibles_to_add->len);
 
     // free generator
     gsl_qrng_free(generator);
+    g_hash_table_unref(accessibles_to_move);
+
+    // swap in the new snapshot, keeping the old ones until the removals of their entries are done
+    if (registry->front)
+        g_ptr_array_add(registry->retired, registry->front);
+    registry->front = snapshot;
+    if (g_queue_is_empty(registry->entries_to_remove))
+        registry_apply_retire(registry);
+
+    // schedule the changes unless already scheduled
+    if (!registry->render_task_id &&
+        (!g_queue_is_empty(registry->entries_to_remove) || !g_queue_is_empty(registry->entries_to_add)))
+        registry->render_task_id = scheduler_add(registry->scheduler, SCHEDULER_PRIORITY_RENDER, registry_apply_render, registry);
+    if (!registry->reposition_task_id &&
+        (registry->window_to_move || !g_queue_is_empty(registry->entries_to_move)))
+        registry->reposition_task_id = scheduler_add(registry->scheduler, SCHEDULER_PRIORITY_REPOSITION, registry_apply_reposition, registry);
+}
+
+// apply a single removal or addition, returns whether there are more
+static gboolean registry_apply_render(gpointer registry_ptr)
+{
+    Registry *registry = registry_ptr;
+    RegistryEntry *entry;
+
+    // remove first, so their tags are free for the additions
+    if ((entry = g_queue_pop_head(registry->entries_to_remove)))
+    {
+        if (registry->subscriber.remove)
+            registry->subscriber.remove(entry, registry->subscriber.data);
+        g_hash_table_remove(registry->accessibles, entry->accessible);
+
+        // the old snapshot is done with once all its removals are
+        if (g_queue_is_empty(registry->entries_to_remove))
+            registry_apply_retire(registry);
+    }
+    // then add
+    else if ((entry = g_queue_pop_head(registry->entries_to_add)))
+    {
+        g_hash_table_insert(registry->accessibles, entry->accessible, entry);
+        if (registry->subscriber.add)
+            registry->subscriber.add(entry, registry->subscriber.data);
+    }
+
+    // continue if there are more
+    if (!g_queue_is_empty(registry->entries_to_remove) || !g_queue_is_empty(registry->entries_to_add))
+        return TRUE;
+
+    // finish this task
+    registry->render_task_id = 0;
+    return FALSE;
+}
+
+// apply the window move or a single accessible move, returns whether there are more
+static gboolean registry_apply_reposition(gpointer registry_ptr)
+{
+    Registry *registry = registry_ptr;
+    RegistryEntry *entry;
+
+    // move the window first, the accessibles are placed relative to it
+    if (registry->window_to_move)
+    {
+        registry->window_to_move = FALSE;
+        if (registry->subscriber.window)
+            registry->subscriber.window(&registry->front->window, registry->subscriber.data);
+    }
+    // then move the accessibles
+    else if ((entry = g_queue_pop_head(registry->entries_to_move)))
+    {
+        if (registry->subscriber.move)
+            registry->subscriber.move(entry, registry->subscriber.data);
+    }
+
+    // continue if there are more
+    if (registry->window_to_move || !g_queue_is_empty(registry->entries_to_move))
+        return TRUE;
+
+    // finish this task
+    registry->reposition_task_id = 0;
+    return FALSE;
+}
+
+// free the previously applied snapshots, once no removal is left none of their entries are applied
+static void registry_apply_retire(Registry *registry)
+{
+    g_ptr_array_set_size(registry->retired, 0);
+}
+
+// check if two extents are the same
+static gboolean registry_extents_equal(AtspiRect *extents, AtspiRect *other_extents)
+{
+    return (extents->x == other_extents->x &&
+            extents->y == other_extents->y &&
+            extents->width == other_extents->width &&
+            extents->height == other_extents->height);
+}
+
+// check if two extents overlap. extents without an area are taken to overlap,
+// as some containers do not report the area of their children
+static gboolean registry_extents_intersect(AtspiRect *extents, AtspiRect *other_extents)
+{
+    if (extents->width <= 0 || extents->height <= 0)
+        return TRUE;
+    return (extents->x < other_extents->x + other_extents->width &&
+            other_extents->x < extents->x + extents->width &&
+            extents->y < other_extents->y + other_extents->height &&
+            other_extents->y < extents->y + extents->height);
+}
+
+// check if the extents fully contain the other extents
+static gboolean registry_extents_contain(AtspiRect *extents, AtspiRect *other_extents)
+{
+    return (extents->x <= other_extents->x &&
+            extents->y <= other_extents->y &&
+            extents->x + extents->width >= other_extents->x + other_extents->width &&
+            extents->y + extents->height >= other_extents->y + other_extents->height);
+}
+
+// create a new entry for an accessible, getting its extents unless already known
+static RegistryEntry *registry_entry_new(Registry *registry, BusObject *accessible, ControlType control_type, AtspiRect *extents)
+{
+    RegistryEntry *entry = g_new(RegistryEntry, 1);
+    entry->accessible = bus_object_copy(accessible);
+    entry->control_type = control_type;
+    if (extents)
+        entry->extents = *extents;
+    else if (!bus_get_extents(registry->bus, accessible, &entry->extents, registry->cancellable))
+        entry->extents = (AtspiRect){0, 0, 0, 0};
+    return entry;
+}
+
+// free an entry
+static void registry_entry_free(gpointer entry_ptr)
+{
+    RegistryEntry *entry = entry_ptr;
+    bus_object_free(entry->accessible);
+    g_free(entry);
+}
+
+// free a snapshot
+static void registry_snapshot_free(RegistrySnapshot *snapshot)
+{
+    bus_object_free(snapshot->window.accessible);
+    g_ptr_array_unref(snapshot->entries);
+    g_free(snapshot);
+}
+
+// create a cursor into the paged matches of a collection
+static RegistryPage *registry_page_new(BusObject *collection, GVariant *rule, gboolean covers, gboolean skips)
+{
+    RegistryPage *page = g_new(RegistryPage, 1);
+    page->collection = bus_object_copy(collection);
+    page->rule = g_variant_ref(rule);
+    page->last = NULL;
+    page->covers = covers;
+    page->skips = skips;
+    return page;
+}
+
+// free a cursor
+static void registry_page_free(gpointer page_ptr)
+{
+    RegistryPage *page = page_ptr;
+    bus_object_free(page->collection);
+    g_variant_unref(page->rule);
+    if (page->last)
+        bus_object_free(page->last);
+    g_free(page);
 }
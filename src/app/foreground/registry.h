@@ -25,36 +25,92 @@
 
 #include "control.h"
 
-// callback type used to add or remove an accessible
-typedef void (*RegistryCallback)(AtspiAccessible *, gpointer data);
+#include "../lib/bus.h"
+#include "../lib/scheduler.h"
+
+// accessible found by the registry, with its control type and screen extents
+typedef struct RegistryEntry
+{
+    BusObject *accessible;
+    ControlType control_type;
+    AtspiRect extents;
+} RegistryEntry;
+
+// immutable result of a refresh, handed from the worker thread to the main thread
+typedef struct RegistrySnapshot
+{
+    RegistryEntry window;
+    GPtrArray *entries;
+} RegistrySnapshot;
+
+// cursor into the paged collection matches of an accessible
+typedef struct RegistryPage
+{
+    BusObject *collection;
+    GVariant *rule;
+    BusObject *last;
+    gboolean covers;
+    gboolean skips;
+} RegistryPage;
+
+// callback type used to add, remove or move an accessible, or move the window
+typedef void (*RegistryCallback)(RegistryEntry *entry, gpointer data);
 
 // callback info for a registry subscriber
 typedef struct RegistrySubscriber
 {
     RegistryCallback add;
     RegistryCallback remove;
+    RegistryCallback move;
+    RegistryCallback window;
     gpointer data;
 } RegistrySubscriber;
 
 // registry that maintains a list of accessibles that can be executed, with
-// support for callback events on add and remove
+// support for callback events on add and remove. accessibles are crawled on the
+// worker thread and the results are applied on the main thread, both sliced
+// into frames by a scheduler
 typedef struct Registry
 {
-    GHashTable *accessibles;
-    AtspiMatchRule *match_interactive;
+    Bus *bus;
+    Scheduler *scheduler;
 
     AtspiAccessible *window;
     RegistrySubscriber subscriber;
 
+    RegistrySnapshot *front;
+    GPtrArray *retired;
+    GHashTable *accessibles;
+    guint apply_source_id;
+    guint render_task_id;
+    guint reposition_task_id;
+    GQueue *entries_to_remove;
+    GQueue *entries_to_add;
+    GQueue *entries_to_move;
+    gboolean window_to_move;
+
+    GMutex mutex;
+    RegistrySnapshot *back;
+
+    GCancellable *cancellable;
+    GVariant *match_interactive;
+    GVariant *match_container;
+    BusObject *refresh_window;
+    gboolean refresh_has_region;
+    AtspiRect refresh_region;
+    BusObject *refresh_root;
     guint refresh_source_id;
+    guint refresh_task_id;
     GList *accessibles_to_process;
+    GList *pages_to_fetch;
     GHashTable *accessibles_to_keep;
-    GPtrArray *accessibles_to_add;
+    GHashTable *accessibles_covered;
+    GPtrArray *entries_to_publish;
 } Registry;
 
-Registry *registry_new();
+Registry *registry_new(Bus *bus, Scheduler *scheduler);
 void registry_destroy(Registry *registry);
-void registry_watch(Registry *registry, AtspiAccessible *window, RegistrySubscriber subscriber);
+void registry_watch(Registry *registry, AtspiAccessible *window, AtspiRect *region, RegistrySubscriber subscriber);
 void registry_unwatch(Registry *registry);
 
 #endif /* FE2ED0B7_0D51_459D_933A_9C5B78C8E618 */
@@ -0,0 +1,227 @@
+/**
+ * Copyright (C) 2021 Ryan Britton
+ *
+ * This file is part of Goodnight Mouse.
+ *
+ * Goodnight Mouse is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Goodnight Mouse is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Goodnight Mouse.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "spatial.h"
+
+// range of cells an area touches
+typedef struct SpatialRange
+{
+    gint column_start;
+    gint column_end;
+    gint row_start;
+    gint row_end;
+} SpatialRange;
+
+static SpatialRange spatial_range(Spatial *spatial, AtspiRect *area);
+static gboolean spatial_range_equal(SpatialRange *range, SpatialRange *other_range);
+static gint64 spatial_cell_key(gint row, gint column);
+static gint spatial_cell_index(Spatial *spatial, gint value);
+
+// creates an empty index with cells of the given size
+Spatial *spatial_new(gint cell_size)
+{
+    Spatial *spatial = g_new(Spatial, 1);
+
+    // init cells, holding the items in each by cell key
+    spatial->cell_size = MAX(cell_size, 1);
+    spatial->cells = g_hash_table_new_full(g_int64_hash, g_int64_equal, g_free, (GDestroyNotify)g_ptr_array_unref);
+
+    // init the area of each item
+    spatial->areas = g_hash_table_new_full(NULL, NULL, NULL, g_free);
+
+    return spatial;
+}
+
+// destroys an index, the items are not freed
+void spatial_destroy(Spatial *spatial)
+{
+    g_hash_table_unref(spatial->cells);
+    g_hash_table_unref(spatial->areas);
+
+    g_free(spatial);
+}
+
+// adds an item at a point, moving it if already added
+void spatial_insert(Spatial *spatial, gpointer item, gint x, gint y)
+{
+    spatial_insert_area(spatial, item, (AtspiRect){x, y, 1, 1});
+}
+
+// moves an item to a new point
+void spatial_move(Spatial *spatial, gpointer item, gint x, gint y)
+{
+    spatial_move_area(spatial, item, (AtspiRect){x, y, 1, 1});
+}
+
+// adds an item over an area, moving it if already added. an area without a
+// size is taken to be the point at its corner
+void spatial_insert_area(Spatial *spatial, gpointer item, AtspiRect area)
+{
+    // move if already added
+    if (g_hash_table_contains(spatial->areas, item))
+    {
+        spatial_move_area(spatial, item, area);
+        return;
+    }
+
+    // save the area
+    AtspiRect *saved_area = g_new(AtspiRect, 1);
+    *saved_area = area;
+    saved_area->width = MAX(saved_area->width, 1);
+    saved_area->height = MAX(saved_area->height, 1);
+    g_hash_table_insert(spatial->areas, item, saved_area);
+
+    // add to the cells
+    SpatialRange range = spatial_range(spatial, saved_area);
+    for (gint row = range.row_start; row <= range.row_end; row++)
+    {
+        for (gint column = range.column_start; column <= range.column_end; column++)
+        {
+            gint64 key = spatial_cell_key(row, column);
+            GPtrArray *cell = g_hash_table_lookup(spatial->cells, &key);
+            if (!cell)
+            {
+                gint64 *cell_key = g_new(gint64, 1);
+                *cell_key = key;
+                cell = g_ptr_array_new();
+                g_hash_table_insert(spatial->cells, cell_key, cell);
+            }
+            g_ptr_array_add(cell, item);
+        }
+    }
+}
+
+// moves an item to a new area
+void spatial_move_area(Spatial *spatial, gpointer item, AtspiRect area)
+{
+    // do nothing if not added
+    AtspiRect *saved_area = g_hash_table_lookup(spatial->areas, item);
+    if (!saved_area)
+        return;
+
+    // only update the area if in the same cells
+    AtspiRect new_area = {area.x, area.y, MAX(area.width, 1), MAX(area.height, 1)};
+    SpatialRange range = spatial_range(spatial, saved_area);
+    SpatialRange new_range = spatial_range(spatial, &new_area);
+    if (spatial_range_equal(&range, &new_range))
+    {
+        *saved_area = new_area;
+        return;
+    }
+
+    // otherwise readd
+    spatial_remove(spatial, item);
+    spatial_insert_area(spatial, item, new_area);
+}
+
+// removes an item
+void spatial_remove(Spatial *spatial, gpointer item)
+{
+    // do nothing if not added
+    AtspiRect *saved_area = g_hash_table_lookup(spatial->areas, item);
+    if (!saved_area)
+        return;
+
+    // remove from the cells, dropping the cells left empty
+    SpatialRange range = spatial_range(spatial, saved_area);
+    for (gint row = range.row_start; row <= range.row_end; row++)
+    {
+        for (gint column = range.column_start; column <= range.column_end; column++)
+        {
+            gint64 key = spatial_cell_key(row, column);
+            GPtrArray *cell = g_hash_table_lookup(spatial->cells, &key);
+            g_ptr_array_remove_fast(cell, item);
+            if (cell->len == 0)
+                g_hash_table_remove(spatial->cells, &key);
+        }
+    }
+
+    // forget the area
+    g_hash_table_remove(spatial->areas, item);
+}
+
+// gets the items with points or areas intersecting the area, free with g_ptr_array_unref
+GPtrArray *spatial_query(Spatial *spatial, AtspiRect area)
+{
+    GPtrArray *items = g_ptr_array_new();
+
+    // check each cell the area touches
+    SpatialRange range = spatial_range(spatial, &area);
+    for (gint row = range.row_start; row <= range.row_end; row++)
+    {
+        for (gint column = range.column_start; column <= range.column_end; column++)
+        {
+            // get the cell
+            gint64 key = spatial_cell_key(row, column);
+            GPtrArray *cell = g_hash_table_lookup(spatial->cells, &key);
+            if (!cell)
+                continue;
+
+            // add the items intersecting the area
+            for (guint index = 0; index < cell->len; index++)
+            {
+                gpointer item = g_ptr_array_index(cell, index);
+                AtspiRect *item_area = g_hash_table_lookup(spatial->areas, item);
+                if (item_area->x >= area.x + area.width || area.x >= item_area->x + item_area->width ||
+                    item_area->y >= area.y + area.height || area.y >= item_area->y + item_area->height)
+                    continue;
+
+                // an item in several cells is only added from the first cell both touch
+                SpatialRange item_range = spatial_range(spatial, item_area);
+                if (row != MAX(range.row_start, item_range.row_start) ||
+                    column != MAX(range.column_start, item_range.column_start))
+                    continue;
+
+                g_ptr_array_add(items, item);
+            }
+        }
+    }
+
+    return items;
+}
+
+// gets the range of cells an area touches
+static SpatialRange spatial_range(Spatial *spatial, AtspiRect *area)
+{
+    return (SpatialRange){
+        .column_start = spatial_cell_index(spatial, area->x),
+        .column_end = spatial_cell_index(spatial, area->x + area->width - 1),
+        .row_start = spatial_cell_index(spatial, area->y),
+        .row_end = spatial_cell_index(spatial, area->y + area->height - 1),
+    };
+}
+
+// check if two ranges of cells are the same
+static gboolean spatial_range_equal(SpatialRange *range, SpatialRange *other_range)
+{
+    return range->column_start == other_range->column_start && range->column_end == other_range->column_end &&
+           range->row_start == other_range->row_start && range->row_end == other_range->row_end;
+}
+
+// gets the key of a cell
+static gint64 spatial_cell_key(gint row, gint column)
+{
+    return ((gint64)row << 32) | (guint32)column;
+}
+
+// gets the index of the cell along an axis, rounding down for negative values
+static gint spatial_cell_index(Spatial *spatial, gint value)
+{
+    return value >= 0 ? value / spatial->cell_size : -((-value - 1) / spatial->cell_size) - 1;
+}
@@ -0,0 +1,46 @@
+/**
+ * Copyright (C) 2021 Ryan Britton
+ *
+ * This file is part of Goodnight Mouse.
+ *
+ * Goodnight Mouse is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Goodnight Mouse is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Goodnight Mouse.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef C0496C87_DDF3_42D4_A299_BBD5F10424FA
+#define C0496C87_DDF3_42D4_A299_BBD5F10424FA
+
+#include <glib.h>
+#include <atspi/atspi.h>
+
+// uniform grid index of items at screen points or over screen areas, found by
+// the area they intersect. an item at a point is in a single cell, so adding,
+// moving and removing it is constant time. an item over an area is in each cell
+// the area touches
+typedef struct Spatial
+{
+    gint cell_size;
+    GHashTable *cells;
+    GHashTable *areas;
+} Spatial;
+
+Spatial *spatial_new(gint cell_size);
+void spatial_destroy(Spatial *spatial);
+void spatial_insert(Spatial *spatial, gpointer item, gint x, gint y);
+void spatial_move(Spatial *spatial, gpointer item, gint x, gint y);
+void spatial_insert_area(Spatial *spatial, gpointer item, AtspiRect area);
+void spatial_move_area(Spatial *spatial, gpointer item, AtspiRect area);
+void spatial_remove(Spatial *spatial, gpointer item);
+GPtrArray *spatial_query(Spatial *spatial, AtspiRect area);
+
+#endif /* C0496C87_DDF3_42D4_A299_BBD5F10424FA */
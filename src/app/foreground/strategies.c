@@ -0,0 +1,180 @@
+/**
+ * Copyright (C) 2021 Ryan Britton
+ *
+ * This file is part of Goodnight Mouse.
+ *
+ * Goodnight Mouse is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Goodnight Mouse is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Goodnight Mouse.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "strategies.h"
+
+#include <glib/gstdio.h>
+
+#define APPLICATION_PATH ATSPI_DBUS_PATH_ROOT
+
+// seconds to wait after a change before saving
+#define SAVE_DELAY (2)
+
+// names of the strategies as saved
+static const gchar *STRATEGY_NAMES[] = {
+    [EXECUTE_STRATEGY_NONE] = "none",
+    [EXECUTE_STRATEGY_ACTION] = "action",
+    [EXECUTE_STRATEGY_FOCUS] = "focus",
+    [EXECUTE_STRATEGY_MOUSE] = "mouse",
+};
+
+static const gchar *strategies_application_name(Strategies *strategies, BusObject *accessible);
+static gboolean strategies_save_timeout(gpointer strategies_ptr);
+static void strategies_save(Strategies *strategies);
+
+// creates a strategy cache, loading the saved strategies
+Strategies *strategies_new(Bus *bus)
+{
+    Strategies *strategies = g_new(Strategies, 1);
+
+    // add dependencies
+    strategies->bus = bus;
+
+    // load the saved strategies, missing if never saved
+    strategies->path = g_build_filename(g_get_user_cache_dir(), STRATEGIES_DIRECTORY, STRATEGIES_FILE, NULL);
+    strategies->key_file = g_key_file_new();
+    GError *error = NULL;
+    g_key_file_load_from_file(strategies->key_file, strategies->path, G_KEY_FILE_NONE, &error);
+    if (error && !g_error_matches(error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+        g_warning("strategies: Failed to load '%s': %s", strategies->path, error->message);
+    g_clear_error(&error);
+    strategies->save_source_id = 0;
+
+    // init the application names by bus name
+    strategies->application_names = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+    return strategies;
+}
+
+// destroys a strategy cache
+void strategies_destroy(Strategies *strategies)
+{
+    // save pending changes
+    if (strategies->save_source_id)
+    {
+        g_source_remove(strategies->save_source_id);
+        strategies_save(strategies);
+    }
+
+    g_hash_table_unref(strategies->application_names);
+    g_key_file_free(strategies->key_file);
+    g_free(strategies->path);
+
+    g_free(strategies);
+}
+
+// gets the strategy that last executed a control of the role in the accessible's
+// application, none if unknown
+ExecuteStrategy strategies_get(Strategies *strategies, BusObject *accessible, AtspiRole role)
+{
+    // get the application
+    const gchar *application = strategies_application_name(strategies, accessible);
+    if (!application)
+        return EXECUTE_STRATEGY_NONE;
+
+    // get the saved name
+    gchar *role_name = atspi_role_get_name(role);
+    gchar *strategy_name = g_key_file_get_string(strategies->key_file, application, role_name, NULL);
+    g_free(role_name);
+    if (!strategy_name)
+        return EXECUTE_STRATEGY_NONE;
+
+    // find the strategy
+    ExecuteStrategy strategy = EXECUTE_STRATEGY_NONE;
+    for (ExecuteStrategy index = 0; index < G_N_ELEMENTS(STRATEGY_NAMES); index++)
+        if (g_strcmp0(strategy_name, STRATEGY_NAMES[index]) == 0)
+            strategy = index;
+    g_free(strategy_name);
+
+    return strategy;
+}
+
+// sets the strategy that executed a control of the role in the accessible's
+// application, saved a while later only if changed
+void strategies_set(Strategies *strategies, BusObject *accessible, AtspiRole role, ExecuteStrategy strategy)
+{
+    // skip if already known
+    if (strategies_get(strategies, accessible, role) == strategy)
+        return;
+
+    // get the application
+    const gchar *application = strategies_application_name(strategies, accessible);
+    if (!application)
+        return;
+
+    // set and schedule the save
+    gchar *role_name = atspi_role_get_name(role);
+    g_debug("strategies: Using '%s' for '%s' in '%s'", STRATEGY_NAMES[strategy], role_name, application);
+    g_key_file_set_string(strategies->key_file, application, role_name, STRATEGY_NAMES[strategy]);
+    g_free(role_name);
+    if (!strategies->save_source_id)
+        strategies->save_source_id = g_timeout_add_seconds(SAVE_DELAY, strategies_save_timeout, strategies);
+}
+
+// gets the name of the accessible's application, which is stable between runs
+// unlike its bus name. only asked once per bus name, applications without a
+// name are remembered as such
+static const gchar *strategies_application_name(Strategies *strategies, BusObject *accessible)
+{
+    // check the cache
+    gpointer cached_name;
+    if (g_hash_table_lookup_extended(strategies->application_names, accessible->bus_name, NULL, &cached_name))
+        return cached_name;
+
+    // ask the application root
+    BusObject *application = bus_object_new(accessible->bus_name, APPLICATION_PATH);
+    gchar *name = NULL;
+    gboolean found = bus_get_name(strategies->bus, application, &name, NULL);
+    bus_object_free(application);
+    if (!found || !name || !*name)
+    {
+        g_free(name);
+        g_hash_table_insert(strategies->application_names, g_strdup(accessible->bus_name), NULL);
+        return NULL;
+    }
+
+    // cache the name, usable as a key file group
+    g_strdelimit(name, "[]\n\r", '_');
+    g_hash_table_insert(strategies->application_names, g_strdup(accessible->bus_name), name);
+    return name;
+}
+
+// timeout source function saving the changed strategies
+static gboolean strategies_save_timeout(gpointer strategies_ptr)
+{
+    Strategies *strategies = strategies_ptr;
+    strategies->save_source_id = 0;
+    strategies_save(strategies);
+    return G_SOURCE_REMOVE;
+}
+
+// saves the strategies to the user cache directory
+static void strategies_save(Strategies *strategies)
+{
+    // ensure the directory exists
+    gchar *directory = g_path_get_dirname(strategies->path);
+    g_mkdir_with_parents(directory, 0700);
+    g_free(directory);
+
+    // save the file
+    GError *error = NULL;
+    if (!g_key_file_save_to_file(strategies->key_file, strategies->path, &error))
+        g_warning("strategies: Failed to save '%s': %s", strategies->path, error->message);
+    g_clear_error(&error);
+}
@@ -0,0 +1,59 @@
+/**
+ * Copyright (C) 2021 Ryan Britton
+ *
+ * This file is part of Goodnight Mouse.
+ *
+ * Goodnight Mouse is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Goodnight Mouse is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Goodnight Mouse.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FD9A7144_697F_4879_9ADE_80C884F0D177
+#define FD9A7144_697F_4879_9ADE_80C884F0D177
+
+#include <glib.h>
+#include <atspi/atspi.h>
+
+#include "../lib/bus.h"
+
+#define STRATEGIES_DIRECTORY "goodnight_mouse"
+#define STRATEGIES_FILE "strategies.ini"
+
+// a way of executing a control
+typedef enum ExecuteStrategy
+{
+    EXECUTE_STRATEGY_NONE,
+    EXECUTE_STRATEGY_ACTION,
+    EXECUTE_STRATEGY_FOCUS,
+    EXECUTE_STRATEGY_MOUSE,
+} ExecuteStrategy;
+
+// cache of the strategy that last executed a control, by application and role.
+// kept in the user cache directory so it is remembered between runs, saved a
+// while after changing to keep disk writes off the execution path
+typedef struct Strategies
+{
+    Bus *bus;
+
+    gchar *path;
+    GKeyFile *key_file;
+    guint save_source_id;
+
+    GHashTable *application_names;
+} Strategies;
+
+Strategies *strategies_new(Bus *bus);
+void strategies_destroy(Strategies *strategies);
+ExecuteStrategy strategies_get(Strategies *strategies, BusObject *accessible, AtspiRole role);
+void strategies_set(Strategies *strategies, BusObject *accessible, AtspiRole role, ExecuteStrategy strategy);
+
+#endif /* FD9A7144_697F_4879_9ADE_80C884F0D177 */
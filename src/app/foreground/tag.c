@@ -34,6 +34,7 @@ Tag *tag_new(TagConfig *config)
     tag->match_index = 0;
 
     tag->accessible = NULL;
+    tag->extents = (AtspiRect){0, 0, 0, 0};
 
     tag->shifted = FALSE;
 
@@ -41,6 +42,7 @@ Tag *tag_new(TagConfig *config)
     tag->parent = NULL;
     tag->window_x = 0;
     tag->window_y = 0;
+    tag->offset_x = 0;
 
     // create the label
     tag->label = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 0);
@@ -92,17 +94,13 @@ void tag_destroy(Tag *tag)
 }
 
 // sets a tag to follow an accessible
-void tag_set_accessible(Tag *tag, AtspiAccessible *accessible)
+void tag_set_accessible(Tag *tag, BusObject *accessible)
 {
     // unset last accessible
     tag_unset_accessible(tag);
 
     // set accessible
-    tag->accessible = g_object_ref(accessible);
-
-    // reposition if shown
-    if (tag->parent)
-        tag_reposition(tag);
+    tag->accessible = bus_object_copy(accessible);
 }
 
 // stops a tag from following an accessible
@@ -113,10 +111,60 @@ void tag_unset_accessible(Tag *tag)
         return;
 
     // unset accessible
-    g_object_unref(tag->accessible);
+    bus_object_free(tag->accessible);
     tag->accessible = NULL;
 }
 
+// sets the screen extents of the accessible a tag follows
+void tag_set_extents(Tag *tag, AtspiRect extents)
+{
+    // set extents
+    tag->extents = extents;
+
+    // reposition if shown
+    if (tag->parent)
+        tag_reposition(tag);
+}
+
+// sets how far a tag's label is moved sideways from its extents
+void tag_set_offset(Tag *tag, gint offset_x)
+{
+    // do nothing if not changed
+    if (offset_x == tag->offset_x)
+        return;
+
+    // set offset
+    tag->offset_x = offset_x;
+
+    // reposition if shown
+    if (tag->parent)
+        tag_reposition(tag);
+}
+
+// gets the width a tag's label takes up when shown
+gint tag_get_label_width(Tag *tag)
+{
+    // generate the label if not yet shown
+    if (!tag->characters && tag->code)
+        tag_generate_label(tag);
+
+    gint width;
+    gtk_widget_get_preferred_width(tag->label, NULL, &width);
+    return width;
+}
+
+// gets the height a tag's label takes up when shown
+gint tag_get_label_height(Tag *tag)
+{
+    // generate the label if not yet shown
+    if (!tag->characters && tag->code)
+        tag_generate_label(tag);
+
+    gint height;
+    gtk_widget_get_preferred_height(tag->label, NULL, &height);
+    return height;
+}
+
 // shiftes a tag to show upper or lower case
 void tag_shifted(Tag *tag, gboolean shifted)
 {
@@ -177,37 +225,25 @@ void tag_hide(Tag *tag)
     tag->parent = NULL;
 }
 
-// repositions a tag over its accessible
+// repositions a tag over its extents
 void tag_reposition(Tag *tag)
 {
-    // stop if no accessible
-    if (!tag->accessible)
-        return;
-
-    // get accessible position
-    AtspiComponent *component = atspi_accessible_get_component_iface(tag->accessible);
-    AtspiRect *rect = atspi_component_get_extents(component, ATSPI_COORD_TYPE_SCREEN, NULL);
-
-    // offset with window coordinates
-    rect->x -= tag->window_x;
-    rect->y -= tag->window_y;
+    // offset with window coordinates and the label offset
+    gint x = tag->extents.x - tag->window_x + tag->offset_x;
+    gint y = tag->extents.y - tag->window_y;
 
     // put/move location in parent if coordinates are valid
-    if (rect->x >= 0 && rect->y >= 0)
+    if (x >= 0 && y >= 0)
     {
         if (gtk_widget_get_parent(tag->wrapper) == GTK_WIDGET(tag->parent))
-            gtk_layout_move(tag->parent, tag->wrapper, rect->x, rect->y);
+            gtk_layout_move(tag->parent, tag->wrapper, x, y);
         else
-            gtk_layout_put(tag->parent, tag->wrapper, rect->x, rect->y);
+            gtk_layout_put(tag->parent, tag->wrapper, x, y);
     }
 
     // set wrapper to cover accessible
-    if (rect->width > 0 && rect->height > 0)
-        gtk_widget_set_size_request(tag->wrapper, rect->width, rect->height);
-
-    // free
-    g_object_unref(component);
-    g_free(rect);
+    if (tag->extents.width > 0 && tag->extents.height > 0)
+        gtk_widget_set_size_request(tag->wrapper, tag->extents.width, tag->extents.height);
 }
 
 // sets a tag's code
@@ -25,18 +25,22 @@
 
 #include "tag_config.h"
 
+#include "../lib/bus.h"
+
 // a tag that can show a code as a gtk widget over an accessible
 typedef struct Tag
 {
     GArray *code;
     gint match_index;
 
-    AtspiAccessible *accessible;
+    BusObject *accessible;
+    AtspiRect extents;
 
     gboolean shifted;
 
     GtkLayout *parent;
     gint window_x, window_y;
+    gint offset_x;
 
     GtkWidget *wrapper;
     GtkWidget *label;
@@ -46,8 +50,12 @@ typedef struct Tag
 Tag *tag_new(TagConfig *config);
 void tag_destroy(Tag *tag);
 
-void tag_set_accessible(Tag *tag, AtspiAccessible *accessible);
+void tag_set_accessible(Tag *tag, BusObject *accessible);
 void tag_unset_accessible(Tag *tag);
+void tag_set_extents(Tag *tag, AtspiRect extents);
+void tag_set_offset(Tag *tag, gint offset_x);
+gint tag_get_label_width(Tag *tag);
+gint tag_get_label_height(Tag *tag);
 
 void tag_shifted(Tag *tag, gboolean shifted);
 
@@ -38,6 +38,8 @@
 #define backend_keyboard_ungrab backend_xcb_keyboard_ungrab
 #define backend_keyboard_grab_key backend_xcb_keyboard_grab_key
 #define backend_keyboard_ungrab_key backend_xcb_keyboard_ungrab_key
+#define backend_keyboard_relay_key backend_xcb_keyboard_relay_key
+#define backend_keyboard_unrelay_key backend_xcb_keyboard_unrelay_key
 
 #include "xcb/pointer.h"
 #define backend_pointer_new backend_xcb_pointer_new
@@ -55,6 +57,8 @@
 #include "xcb/emulator.h"
 #define backend_emulator_new backend_xcb_emulator_new
 #define backend_emulator_destroy backend_xcb_emulator_destroy
+#define backend_emulator_begin backend_xcb_emulator_begin
+#define backend_emulator_commit backend_xcb_emulator_commit
 #define backend_emulator_reset backend_xcb_emulator_reset
 #define backend_emulator_state backend_xcb_emulator_state
 #define backend_emulator_key backend_xcb_emulator_key
@@ -78,6 +82,8 @@
 #define backend_keyboard_ungrab backend_legacy_keyboard_ungrab
 #define backend_keyboard_grab_key backend_legacy_keyboard_grab_key
 #define backend_keyboard_ungrab_key backend_legacy_keyboard_ungrab_key
+#define backend_keyboard_relay_key backend_legacy_keyboard_relay_key
+#define backend_keyboard_unrelay_key backend_legacy_keyboard_unrelay_key
 
 #include "legacy/pointer.h"
 #define backend_pointer_new backend_legacy_pointer_new
@@ -95,6 +101,8 @@
 #include "legacy/emulator.h"
 #define backend_emulator_new backend_legacy_emulator_new
 #define backend_emulator_destroy backend_legacy_emulator_destroy
+#define backend_emulator_begin backend_legacy_emulator_begin
+#define backend_emulator_commit backend_legacy_emulator_commit
 #define backend_emulator_reset backend_legacy_emulator_reset
 #define backend_emulator_state backend_legacy_emulator_state
 #define backend_emulator_key backend_legacy_emulator_key
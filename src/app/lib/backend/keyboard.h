@@ -24,13 +24,6 @@
 
 #include "state.h"
 
-// whether the event should be passed through or not
-typedef enum BackendKeyboardEventResponse
-{
-    BACKEND_KEYBOARD_EVENT_RELAY,
-    BACKEND_KEYBOARD_EVENT_CONSUME,
-} BackendKeyboardEventResponse;
-
 // event representing a key action
 typedef struct BackendKeyboardEvent
 {
@@ -40,6 +33,6 @@ typedef struct BackendKeyboardEvent
 } BackendKeyboardEvent;
 
 // callback used for keyboard events
-typedef BackendKeyboardEventResponse (*BackendKeyboardCallback)(BackendKeyboardEvent event, gpointer data);
+typedef void (*BackendKeyboardCallback)(BackendKeyboardEvent event, gpointer data);
 
 #endif /* C34EFBD7_588C_4399_8DEF_C92876EB3C3D */
@@ -41,6 +41,18 @@ void backend_legacy_emulator_destroy(BackendLegacyEmulator *emulator)
     g_free(emulator);
 }
 
+// begin a sequence of emulated events, atspi sends each event on its own
+gboolean backend_legacy_emulator_begin(BackendLegacyEmulator *emulator)
+{
+    return TRUE;
+}
+
+// commit a sequence of emulated events
+gboolean backend_legacy_emulator_commit(BackendLegacyEmulator *emulator)
+{
+    return TRUE;
+}
+
 // reset any emulated elements
 gboolean backend_legacy_emulator_reset(BackendLegacyEmulator *emulator)
 {
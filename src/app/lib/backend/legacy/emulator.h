@@ -37,6 +37,8 @@ typedef struct BackendLegacyEmulator
 
 BackendLegacyEmulator *backend_legacy_emulator_new(BackendLegacy *backend);
 void backend_legacy_emulator_destroy(BackendLegacyEmulator *emulator);
+gboolean backend_legacy_emulator_begin(BackendLegacyEmulator *emulator);
+gboolean backend_legacy_emulator_commit(BackendLegacyEmulator *emulator);
 gboolean backend_legacy_emulator_reset(BackendLegacyEmulator *emulator);
 gboolean backend_legacy_emulator_state(BackendLegacyEmulator *emulator, BackendStateEvent state);
 gboolean backend_legacy_emulator_key(BackendLegacyEmulator *emulator, BackendKeyboardEvent event);
@@ -23,6 +23,7 @@
 #define WINDOW_DEACTIVATE_EVENT "window:deactivate"
 
 static void callback_focus(AtspiEvent *event, gpointer focus_ptr);
+static gboolean callback_notify(gpointer focus_ptr);
 
 // create a new legacy focus listener
 BackendLegacyFocus *backend_legacy_focus_new(BackendLegacy *backend, BackendFocusCallback callback, gpointer data)
@@ -36,6 +37,10 @@ BackendLegacyFocus *backend_legacy_focus_new(BackendLegacy *backend, BackendFocu
     focus->callback = callback;
     focus->data = data;
 
+    // init notifications
+    g_mutex_init(&focus->mutex);
+    focus->notify_source_id = 0;
+
     // register listeners
     focus->listener = atspi_event_listener_new(callback_focus, focus, NULL);
     atspi_event_listener_register(focus->listener, WINDOW_ACTIVATE_EVENT, NULL);
@@ -52,6 +57,13 @@ void backend_legacy_focus_destroy(BackendLegacyFocus *focus)
     atspi_event_listener_deregister(focus->listener, WINDOW_DEACTIVATE_EVENT, NULL);
     g_object_unref(focus->listener);
 
+    // remove pending notification
+    g_mutex_lock(&focus->mutex);
+    if (focus->notify_source_id)
+        g_source_remove(focus->notify_source_id);
+    g_mutex_unlock(&focus->mutex);
+    g_mutex_clear(&focus->mutex);
+
     // free
     g_free(focus);
 }
@@ -111,7 +123,7 @@ AtspiAccessible *backend_legacy_focus_get_window(BackendLegacyFocus *focus)
     return accessible;
 }
 
-// handles a window activation and deactivation event
+// handles a window activation and deactivation event, received on the atspi thread
 static void callback_focus(AtspiEvent *event, gpointer focus_ptr)
 {
     BackendLegacyFocus *focus = focus_ptr;
@@ -119,6 +131,25 @@ static void callback_focus(AtspiEvent *event, gpointer focus_ptr)
     // free the event
     g_boxed_free(ATSPI_TYPE_EVENT, event);
 
+    // send a single notification from the main thread
+    g_mutex_lock(&focus->mutex);
+    if (!focus->notify_source_id)
+        focus->notify_source_id = g_idle_add(callback_notify, focus);
+    g_mutex_unlock(&focus->mutex);
+}
+
+// sends the focus notification on the main thread
+static gboolean callback_notify(gpointer focus_ptr)
+{
+    BackendLegacyFocus *focus = focus_ptr;
+
+    // allow the next notification
+    g_mutex_lock(&focus->mutex);
+    focus->notify_source_id = 0;
+    g_mutex_unlock(&focus->mutex);
+
     // send a notification
     focus->callback(focus->data);
+
+    return G_SOURCE_REMOVE;
 }
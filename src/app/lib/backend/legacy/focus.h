@@ -34,6 +34,9 @@ typedef struct BackendLegacyFocus
     gpointer data;
 
     AtspiEventListener *listener;
+
+    GMutex mutex;
+    guint notify_source_id;
 } BackendLegacyFocus;
 
 BackendLegacyFocus *backend_legacy_focus_new(BackendLegacy *backend, BackendFocusCallback callback, gpointer data);
@@ -19,7 +19,13 @@
 
 #include "keyboard.h"
 
+// key of a keycode and modifiers
+#define KEYS_KEY(keycode, modifiers) GUINT_TO_POINTER(((keycode) << 8) | ((modifiers) & 0xFF))
+
+static void add_key(GHashTable *keys, guint keycode, guint8 modifiers);
+static void remove_key(GHashTable *keys, guint keycode, guint8 modifiers);
 static gboolean callback_keyboard(AtspiDeviceEvent *atspi_event, gpointer keyboard_ptr);
+static gboolean callback_notify(gpointer keyboard_ptr);
 
 // create a new keyboard listener
 BackendLegacyKeyboard *backend_legacy_keyboard_new(BackendLegacy *backend, BackendKeyboardCallback callback, gpointer data)
@@ -33,6 +39,16 @@ BackendLegacyKeyboard *backend_legacy_keyboard_new(BackendLegacy *backend, Backe
     keyboard->callback = callback;
     keyboard->data = data;
 
+    // init events waiting for the main thread
+    g_mutex_init(&keyboard->mutex);
+    keyboard->events = g_queue_new();
+    keyboard->notify_source_id = 0;
+
+    // init grabs and relays, keys are counted by keycode and modifiers
+    keyboard->grabs = 0;
+    keyboard->grab_keys = g_hash_table_new(NULL, NULL);
+    keyboard->relay_keys = g_hash_table_new(NULL, NULL);
+
     // register listener
     keyboard->listener = atspi_device_listener_new(callback_keyboard, keyboard, NULL);
     for (gint modifiers = 0; modifiers < 0xFF; modifiers++)
@@ -62,6 +78,18 @@ void backend_legacy_keyboard_destroy(BackendLegacyKeyboard *keyboard)
     }
     g_object_unref(keyboard->listener);
 
+    // free events waiting for the main thread
+    g_mutex_lock(&keyboard->mutex);
+    if (keyboard->notify_source_id)
+        g_source_remove(keyboard->notify_source_id);
+    g_queue_free_full(keyboard->events, g_free);
+    g_mutex_unlock(&keyboard->mutex);
+    g_mutex_clear(&keyboard->mutex);
+
+    // free grabs and relays
+    g_hash_table_unref(keyboard->grab_keys);
+    g_hash_table_unref(keyboard->relay_keys);
+
     // free
     g_free(keyboard);
 }
@@ -69,27 +97,74 @@ void backend_legacy_keyboard_destroy(BackendLegacyKeyboard *keyboard)
 // grab all keyboard input
 void backend_legacy_keyboard_grab(BackendLegacyKeyboard *keyboard)
 {
-    // do nothing, keyboard is already grabbed by listener
+    // keyboard is already grabbed by listener, only track which events to consume
+    g_mutex_lock(&keyboard->mutex);
+    keyboard->grabs++;
+    g_mutex_unlock(&keyboard->mutex);
 }
 
 // ungrab all keyboard input
 void backend_legacy_keyboard_ungrab(BackendLegacyKeyboard *keyboard)
 {
-    // do nothing, keyboard is already grabbed by listener
+    // keyboard is already grabbed by listener, only track which events to consume
+    g_mutex_lock(&keyboard->mutex);
+    if (keyboard->grabs > 0)
+        keyboard->grabs--;
+    g_mutex_unlock(&keyboard->mutex);
 }
 
 // grab input of a specific key
 void backend_legacy_keyboard_grab_key(BackendLegacyKeyboard *keyboard, guint keycode, BackendStateEvent state)
 {
-    // do nothing, keyboard is already grabbed by listener
+    // keyboard is already grabbed by listener, only track which events to consume
+    g_mutex_lock(&keyboard->mutex);
+    add_key(keyboard->grab_keys, keycode, state.modifiers);
+    g_mutex_unlock(&keyboard->mutex);
 }
 
 // ungrab input of a specific key
 void backend_legacy_keyboard_ungrab_key(BackendLegacyKeyboard *keyboard, guint keycode, BackendStateEvent state)
 {
-    // do nothing, keyboard is already grabbed by listener
+    // keyboard is already grabbed by listener, only track which events to consume
+    g_mutex_lock(&keyboard->mutex);
+    remove_key(keyboard->grab_keys, keycode, state.modifiers);
+    g_mutex_unlock(&keyboard->mutex);
+}
+
+// let a key pass through to the focused window while grabbed
+void backend_legacy_keyboard_relay_key(BackendLegacyKeyboard *keyboard, guint keycode, BackendStateEvent state)
+{
+    g_mutex_lock(&keyboard->mutex);
+    add_key(keyboard->relay_keys, keycode, state.modifiers);
+    g_mutex_unlock(&keyboard->mutex);
+}
+
+// stop letting a key pass through while grabbed
+void backend_legacy_keyboard_unrelay_key(BackendLegacyKeyboard *keyboard, guint keycode, BackendStateEvent state)
+{
+    g_mutex_lock(&keyboard->mutex);
+    remove_key(keyboard->relay_keys, keycode, state.modifiers);
+    g_mutex_unlock(&keyboard->mutex);
+}
+
+// count a key in a set of keys
+static void add_key(GHashTable *keys, guint keycode, guint8 modifiers)
+{
+    guint count = GPOINTER_TO_UINT(g_hash_table_lookup(keys, KEYS_KEY(keycode, modifiers)));
+    g_hash_table_insert(keys, KEYS_KEY(keycode, modifiers), GUINT_TO_POINTER(count + 1));
 }
 
+// uncount a key in a set of keys
+static void remove_key(GHashTable *keys, guint keycode, guint8 modifiers)
+{
+    guint count = GPOINTER_TO_UINT(g_hash_table_lookup(keys, KEYS_KEY(keycode, modifiers)));
+    if (count > 1)
+        g_hash_table_insert(keys, KEYS_KEY(keycode, modifiers), GUINT_TO_POINTER(count - 1));
+    else
+        g_hash_table_remove(keys, KEYS_KEY(keycode, modifiers));
+}
+
+// handles a key event, received on the atspi thread
 static gboolean callback_keyboard(AtspiDeviceEvent *atspi_event, gpointer keyboard_ptr)
 {
     BackendLegacyKeyboard *keyboard = keyboard_ptr;
@@ -105,9 +180,42 @@ static gboolean callback_keyboard(AtspiDeviceEvent *atspi_event, gpointer keyboa
     // free the atspi event
     g_boxed_free(ATSPI_TYPE_DEVICE_EVENT, atspi_event);
 
-    // send the event
-    BackendKeyboardEventResponse response = keyboard->callback(event, keyboard->data);
+    g_mutex_lock(&keyboard->mutex);
+
+    // decide whether to consume, relayed keys pass through and grabbed keys are consumed
+    gboolean consume = (!g_hash_table_contains(keyboard->relay_keys, KEYS_KEY(event.keycode, event.state.modifiers)) &&
+                        (keyboard->grabs > 0 ||
+                         g_hash_table_contains(keyboard->grab_keys, KEYS_KEY(event.keycode, event.state.modifiers))));
+
+    // send the event from the main thread
+    BackendKeyboardEvent *queued_event = g_new(BackendKeyboardEvent, 1);
+    *queued_event = event;
+    g_queue_push_tail(keyboard->events, queued_event);
+    if (!keyboard->notify_source_id)
+        keyboard->notify_source_id = g_idle_add(callback_notify, keyboard);
+
+    g_mutex_unlock(&keyboard->mutex);
 
     // tell atspi whether to consume
-    return (response == BACKEND_KEYBOARD_EVENT_CONSUME) ? TRUE : FALSE;
+    return consume;
+}
+
+// sends the waiting events on the main thread
+static gboolean callback_notify(gpointer keyboard_ptr)
+{
+    BackendLegacyKeyboard *keyboard = keyboard_ptr;
+
+    // take the waiting events
+    g_mutex_lock(&keyboard->mutex);
+    GQueue *events = keyboard->events;
+    keyboard->events = g_queue_new();
+    keyboard->notify_source_id = 0;
+    g_mutex_unlock(&keyboard->mutex);
+
+    // send the events
+    for (GList *link = events->head; link; link = link->next)
+        keyboard->callback(*(BackendKeyboardEvent *)link->data, keyboard->data);
+    g_queue_free_full(events, g_free);
+
+    return G_SOURCE_REMOVE;
 }
@@ -34,6 +34,14 @@ typedef struct BackendLegacyKeyboard
     gpointer data;
 
     AtspiDeviceListener *listener;
+
+    GMutex mutex;
+    GQueue *events;
+    guint notify_source_id;
+
+    gint grabs;
+    GHashTable *grab_keys;
+    GHashTable *relay_keys;
 } BackendLegacyKeyboard;
 
 BackendLegacyKeyboard *backend_legacy_keyboard_new(BackendLegacy *backend, BackendKeyboardCallback callback, gpointer data);
@@ -42,5 +50,7 @@ void backend_legacy_keyboard_grab(BackendLegacyKeyboard *keyboard);
 void backend_legacy_keyboard_ungrab(BackendLegacyKeyboard *keyboard);
 void backend_legacy_keyboard_grab_key(BackendLegacyKeyboard *keyboard, guint keycode, BackendStateEvent state);
 void backend_legacy_keyboard_ungrab_key(BackendLegacyKeyboard *keyboard, guint keycode, BackendStateEvent state);
+void backend_legacy_keyboard_relay_key(BackendLegacyKeyboard *keyboard, guint keycode, BackendStateEvent state);
+void backend_legacy_keyboard_unrelay_key(BackendLegacyKeyboard *keyboard, guint keycode, BackendStateEvent state);
 
 #endif /* F57F1019_9CFE_4F5D_A723_17B8C671BC05 */
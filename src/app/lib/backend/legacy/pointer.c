@@ -20,6 +20,7 @@
 #include "pointer.h"
 
 static gboolean callback_pointer(AtspiDeviceEvent *atspi_event, gpointer pointer_ptr);
+static gboolean callback_notify(gpointer pointer_ptr);
 
 // create a new pointer listener
 BackendLegacyPointer *backend_legacy_pointer_new(BackendLegacy *backend, BackendPointerCallback callback, gpointer data)
@@ -33,6 +34,11 @@ BackendLegacyPointer *backend_legacy_pointer_new(BackendLegacy *backend, Backend
     pointer->callback = callback;
     pointer->data = data;
 
+    // init events waiting for the main thread
+    g_mutex_init(&pointer->mutex);
+    pointer->events = g_queue_new();
+    pointer->notify_source_id = 0;
+
     // register listener
     pointer->listener = atspi_device_listener_new(callback_pointer, pointer, NULL);
     atspi_register_device_event_listener(pointer->listener,
@@ -50,6 +56,14 @@ void backend_legacy_pointer_destroy(BackendLegacyPointer *pointer)
     atspi_deregister_device_event_listener(pointer->listener, NULL, NULL);
     g_object_unref(pointer->listener);
 
+    // free events waiting for the main thread
+    g_mutex_lock(&pointer->mutex);
+    if (pointer->notify_source_id)
+        g_source_remove(pointer->notify_source_id);
+    g_queue_free_full(pointer->events, g_free);
+    g_mutex_unlock(&pointer->mutex);
+    g_mutex_clear(&pointer->mutex);
+
     // free
     g_free(pointer);
 }
@@ -78,6 +92,7 @@ void backend_legacy_pointer_ungrab_button(BackendLegacyPointer *pointer, guint b
     // do nothing, pointer is already grabbed by listener
 }
 
+// handles a button event, received on the atspi thread
 static gboolean callback_pointer(AtspiDeviceEvent *atspi_event, gpointer pointer_ptr)
 {
     BackendLegacyPointer *pointer = pointer_ptr;
@@ -93,9 +108,35 @@ static gboolean callback_pointer(AtspiDeviceEvent *atspi_event, gpointer pointer
     // free the atspi event
     g_boxed_free(ATSPI_TYPE_DEVICE_EVENT, atspi_event);
 
-    // send the event
-    BackendPointerEventResponse response = pointer->callback(event, pointer->data);
+    // send the event from the main thread
+    g_mutex_lock(&pointer->mutex);
+    BackendPointerEvent *queued_event = g_new(BackendPointerEvent, 1);
+    *queued_event = event;
+    g_queue_push_tail(pointer->events, queued_event);
+    if (!pointer->notify_source_id)
+        pointer->notify_source_id = g_idle_add(callback_notify, pointer);
+    g_mutex_unlock(&pointer->mutex);
+
+    // pointer events are always passed through
+    return FALSE;
+}
+
+// sends the waiting events on the main thread
+static gboolean callback_notify(gpointer pointer_ptr)
+{
+    BackendLegacyPointer *pointer = pointer_ptr;
+
+    // take the waiting events
+    g_mutex_lock(&pointer->mutex);
+    GQueue *events = pointer->events;
+    pointer->events = g_queue_new();
+    pointer->notify_source_id = 0;
+    g_mutex_unlock(&pointer->mutex);
+
+    // send the events
+    for (GList *link = events->head; link; link = link->next)
+        pointer->callback(*(BackendPointerEvent *)link->data, pointer->data);
+    g_queue_free_full(events, g_free);
 
-    // tell atspi whether to consume
-    return (response == BACKEND_POINTER_EVENT_CONSUME) ? TRUE : FALSE;
+    return G_SOURCE_REMOVE;
 }
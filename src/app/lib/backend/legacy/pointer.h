@@ -34,6 +34,10 @@ typedef struct BackendLegacyPointer
     gpointer data;
 
     AtspiDeviceListener *listener;
+
+    GMutex mutex;
+    GQueue *events;
+    guint notify_source_id;
 } BackendLegacyPointer;
 
 BackendLegacyPointer *backend_legacy_pointer_new(BackendLegacy *backend, BackendPointerCallback callback, gpointer data);
@@ -24,13 +24,6 @@
 
 #include "state.h"
 
-// whether the event should be passed through or not
-typedef enum BackendPointerEventResponse
-{
-    BACKEND_POINTER_EVENT_RELAY,
-    BACKEND_POINTER_EVENT_CONSUME,
-} BackendPointerEventResponse;
-
 // event representing a key action
 typedef struct BackendPointerEvent
 {
@@ -40,6 +33,6 @@ typedef struct BackendPointerEvent
 } BackendPointerEvent;
 
 // callback used for pointer events
-typedef BackendPointerEventResponse (*BackendPointerCallback)(BackendPointerEvent event, gpointer data);
+typedef void (*BackendPointerCallback)(BackendPointerEvent event, gpointer data);
 
 #endif /* C18A4891_9E78_4E59_8C06_6BD9C6108DA3 */
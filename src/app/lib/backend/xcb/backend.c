@@ -21,6 +21,12 @@
 
 #include "source.h"
 
+// key of the subscribers for an extension and event type
+#define SUBSCRIBERS_KEY(extension, type) GUINT_TO_POINTER(((extension) << 8) | (type))
+
+// event types that can be selected by an event mask
+#define NUM_MASK_TYPES (32)
+
 // subscriber to xcb events
 typedef struct Subscriber
 {
@@ -31,6 +37,7 @@ typedef struct Subscriber
 } Subscriber;
 
 static gboolean process_event(xcb_generic_event_t *event, gpointer backend_ptr);
+static void free_subscribers(gpointer subscribers_ptr);
 
 // create a new backend using xcb
 BackendXCB *backend_xcb_new()
@@ -53,30 +60,44 @@ BackendXCB *backend_xcb_new()
         g_error("backend-xcb: XInputExtension not found");
     backend->extension_xinput = xinput_reply->major_opcode;
 
-    // select xinput events
-    struct
-    {
-        xcb_input_event_mask_t head;
-        xcb_input_xi_event_mask_t mask;
-    } xinput_mask;
-    xinput_mask.head.deviceid = XCB_INPUT_DEVICE_ALL;
-    xinput_mask.head.mask_len = sizeof(xinput_mask.mask) / sizeof(uint32_t);
-    xinput_mask.mask = XCB_INPUT_XI_EVENT_MASK_KEY_PRESS |
-                       XCB_INPUT_XI_EVENT_MASK_KEY_RELEASE |
-                       XCB_INPUT_XI_EVENT_MASK_BUTTON_PRESS |
-                       XCB_INPUT_XI_EVENT_MASK_BUTTON_RELEASE;
-    xcb_input_xi_select_events(backend->connection, backend->root_window, 1, &xinput_mask.head);
+    // get the xkb event code
+    const xcb_query_extension_reply_t *xkb_reply = xcb_get_extension_data(backend->connection, &xcb_xkb_id);
+    if (!xkb_reply || !xkb_reply->present)
+        g_error("backend-xcb: XKEYBOARD extension not found");
+    backend->extension_xkb_event = xkb_reply->first_event;
+
+    // select xkb state and modifier mapping events of the core keyboard
+    free(xcb_xkb_use_extension_reply(backend->connection,
+                                     xcb_xkb_use_extension(backend->connection, XCB_XKB_MAJOR_VERSION, XCB_XKB_MINOR_VERSION),
+                                     NULL));
+    xcb_xkb_select_events(backend->connection, XCB_XKB_ID_USE_CORE_KBD,
+                          XCB_XKB_EVENT_TYPE_STATE_NOTIFY | XCB_XKB_EVENT_TYPE_MAP_NOTIFY, 0,
+                          XCB_XKB_EVENT_TYPE_STATE_NOTIFY | XCB_XKB_EVENT_TYPE_MAP_NOTIFY,
+                          XCB_XKB_MAP_PART_MODIFIER_MAP, XCB_XKB_MAP_PART_MODIFIER_MAP, NULL);
+
+    // listen to xinput events on the input thread, raw events are consumed there by the state
+    backend->input = backend_xcb_input_new(XCB_INPUT_XI_EVENT_MASK_KEY_PRESS |
+                                           XCB_INPUT_XI_EVENT_MASK_KEY_RELEASE |
+                                           XCB_INPUT_XI_EVENT_MASK_BUTTON_PRESS |
+                                           XCB_INPUT_XI_EVENT_MASK_BUTTON_RELEASE |
+                                           XCB_INPUT_XI_EVENT_MASK_RAW_KEY_PRESS |
+                                           XCB_INPUT_XI_EVENT_MASK_RAW_KEY_RELEASE |
+                                           XCB_INPUT_XI_EVENT_MASK_RAW_MOTION);
 
     // add the event source
     backend->source = xcb_source_new(backend->connection);
     g_source_set_callback(backend->source, G_SOURCE_FUNC(process_event), backend, NULL);
     g_source_attach(backend->source, NULL);
 
+    // add the source of events passed on by the input thread
+    g_source_set_callback(backend_xcb_input_get_source(backend->input), G_SOURCE_FUNC(process_event), backend, NULL);
+    g_source_attach(backend_xcb_input_get_source(backend->input), NULL);
+
     // create legacy backend
     backend->legacy = backend_legacy_new();
 
-    // init the subscribers
-    backend->subscribers = NULL;
+    // init the subscribers, indexed by extension and event type
+    backend->subscribers = g_hash_table_new_full(NULL, NULL, NULL, free_subscribers);
 
     // return
     return backend;
@@ -85,6 +106,9 @@ BackendXCB *backend_xcb_new()
 // destroy the backend
 void backend_xcb_destroy(BackendXCB *backend)
 {
+    // stop the input thread
+    backend_xcb_input_destroy(backend->input);
+
     // close connection
     xcb_disconnect(backend->connection);
 
@@ -96,7 +120,7 @@ void backend_xcb_destroy(BackendXCB *backend)
     backend_legacy_destroy(backend->legacy);
 
     // free subscribers
-    g_list_free_full(backend->subscribers, g_free);
+    g_hash_table_unref(backend->subscribers);
 
     // free
     g_free(backend);
@@ -105,36 +129,59 @@ void backend_xcb_destroy(BackendXCB *backend)
 // subscribe to xcb events
 void backend_xcb_subscribe(BackendXCB *backend, BackendXCBExtension extension, guint32 event_mask, BackendXCBCallback callback, gpointer data)
 {
-    // create new subscriber
-    Subscriber *subscriber = g_new(Subscriber, 1);
-    subscriber->extension = extension;
-    subscriber->event_mask = event_mask;
-    subscriber->callback = callback;
-    subscriber->data = data;
-
-    // add the subscriber
-    backend->subscribers = g_list_append(backend->subscribers, subscriber);
+    // add a subscriber for each event type in the mask
+    for (guint8 type = 0; type < NUM_MASK_TYPES; type++)
+    {
+        if (!(event_mask & (1u << type)))
+            continue;
+
+        // create new subscriber
+        Subscriber *subscriber = g_new(Subscriber, 1);
+        subscriber->extension = extension;
+        subscriber->event_mask = event_mask;
+        subscriber->callback = callback;
+        subscriber->data = data;
+
+        // add the subscriber
+        GList *subscribers = g_hash_table_lookup(backend->subscribers, SUBSCRIBERS_KEY(extension, type));
+        subscribers = g_list_append(subscribers, subscriber);
+        g_hash_table_steal(backend->subscribers, SUBSCRIBERS_KEY(extension, type));
+        g_hash_table_insert(backend->subscribers, SUBSCRIBERS_KEY(extension, type), subscribers);
+    }
 }
 
 // unsubscribe from xcb events
 void backend_xcb_unsubscribe(BackendXCB *backend, BackendXCBExtension extension, guint32 event_mask, BackendXCBCallback callback, gpointer data)
 {
-    // remove the first matching subscriber
-    for (GList *link = backend->subscribers; link; link = link->next)
+    // remove the subscriber for each event type in the mask
+    for (guint8 type = 0; type < NUM_MASK_TYPES; type++)
     {
-        Subscriber *subscriber = link->data;
-
-        // check if subscriber matches
-        if (!(subscriber->extension == extension &&
-              subscriber->event_mask == event_mask &&
-              subscriber->callback == callback &&
-              subscriber->data == data))
+        if (!(event_mask & (1u << type)))
             continue;
 
-        // remove subscriber
-        backend->subscribers = g_list_delete_link(backend->subscribers, link);
-        g_free(subscriber);
-        return;
+        // remove the first matching subscriber
+        GList *subscribers = g_hash_table_lookup(backend->subscribers, SUBSCRIBERS_KEY(extension, type));
+        for (GList *link = subscribers; link; link = link->next)
+        {
+            Subscriber *subscriber = link->data;
+
+            // check if subscriber matches
+            if (!(subscriber->extension == extension &&
+                  subscriber->event_mask == event_mask &&
+                  subscriber->callback == callback &&
+                  subscriber->data == data))
+                continue;
+
+            // remove subscriber
+            subscribers = g_list_delete_link(subscribers, link);
+            g_free(subscriber);
+            break;
+        }
+
+        // update the subscribers
+        g_hash_table_steal(backend->subscribers, SUBSCRIBERS_KEY(extension, type));
+        if (subscribers)
+            g_hash_table_insert(backend->subscribers, SUBSCRIBERS_KEY(extension, type), subscribers);
     }
 }
 
@@ -150,6 +197,12 @@ xcb_window_t backend_xcb_get_root_window(BackendXCB *backend)
     return backend->root_window;
 }
 
+// get the input thread
+BackendXCBInput *backend_xcb_get_input(BackendXCB *backend)
+{
+    return backend->input;
+}
+
 // get the legacy fallback backend
 BackendLegacy *backend_xcb_get_legacy(BackendXCB *backend)
 {
@@ -161,6 +214,15 @@ static gboolean process_event(xcb_generic_event_t *event, gpointer backend_ptr)
 {
     BackendXCB *backend = backend_ptr;
 
+    // log errors of unchecked requests
+    if (event->response_type == 0)
+    {
+        xcb_generic_error_t *error = (xcb_generic_error_t *)event;
+        g_warning("backend-xcb: Request failed: error: %d, major: %d, minor: %d, sequence: %d",
+                  error->error_code, error->major_code, error->minor_code, error->sequence);
+        return G_SOURCE_CONTINUE;
+    }
+
     // get event extension and type
     BackendXCBExtension extension = BACKEND_XCB_EXTENSION_NONE;
     guint8 type = event->response_type;
@@ -173,21 +235,26 @@ static gboolean process_event(xcb_generic_event_t *event, gpointer backend_ptr)
             type = ge_event->event_type;
         }
     }
+    else if (type == backend->extension_xkb_event)
+    {
+        // all xkb events share the header holding the xkb type
+        extension = BACKEND_XCB_EXTENSION_XKB;
+        type = ((xcb_xkb_state_notify_event_t *)event)->xkbType;
+    }
 
-    // notify subscribers
-    for (GList *link = backend->subscribers; link; link = link->next)
+    // notify subscribers of this event type
+    GList *subscribers = g_hash_table_lookup(backend->subscribers, SUBSCRIBERS_KEY(extension, type));
+    for (GList *link = subscribers; link; link = link->next)
     {
         Subscriber *subscriber = link->data;
-
-        // check if subscriber matches
-        // todo: do you need to do (event->response_type & ~0x80)?
-        if (!((subscriber->extension == extension) &&
-              (subscriber->event_mask & (1 << type))))
-            continue;
-
-        // notify subscriber
         subscriber->callback(event, subscriber->data);
     }
 
     return G_SOURCE_CONTINUE;
 }
+
+// free a list of subscribers
+static void free_subscribers(gpointer subscribers_ptr)
+{
+    g_list_free_full(subscribers_ptr, g_free);
+}
@@ -23,14 +23,17 @@
 #include <glib.h>
 #include <xcb/xcb.h>
 #include <xcb/xinput.h>
+#include <xcb/xkb.h>
 
 #include "../legacy/backend.h"
+#include "input.h"
 
 // xcb event extensions
 typedef enum BackendXCBExtension
 {
     BACKEND_XCB_EXTENSION_NONE,
     BACKEND_XCB_EXTENSION_XINPUT,
+    BACKEND_XCB_EXTENSION_XKB,
 } BackendXCBExtension;
 
 // subscriber callback to xcb events
@@ -44,10 +47,13 @@ typedef struct BackendXCB
     GSource *source;
 
     uint8_t extension_xinput;
+    uint8_t extension_xkb_event;
+
+    BackendXCBInput *input;
 
     BackendLegacy *legacy;
 
-    GList *subscribers;
+    GHashTable *subscribers;
 } BackendXCB;
 
 BackendXCB *backend_xcb_new();
@@ -57,5 +63,6 @@ void backend_xcb_subscribe(BackendXCB *backend, BackendXCBExtension extension, g
 void backend_xcb_unsubscribe(BackendXCB *backend, BackendXCBExtension extension, guint32 event_mask, BackendXCBCallback callback, gpointer data);
 xcb_connection_t *backend_xcb_get_connection(BackendXCB *backend);
 xcb_window_t backend_xcb_get_root_window(BackendXCB *backend);
+BackendXCBInput *backend_xcb_get_input(BackendXCB *backend);
 BackendLegacy *backend_xcb_get_legacy(BackendXCB *backend);
 #endif /* BDF15D43_14FE_4926_8658_DE1AECF65525 */
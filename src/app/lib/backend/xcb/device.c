@@ -24,6 +24,9 @@
 #define USE_XCB_GLOBAL_PASSIVE_GRAB (1)
 #endif
 
+// key of a relayed detail, group and modifiers
+#define RELAYS_KEY(detail, group, modifiers) GUINT_TO_POINTER(((detail) << 16) | (((group) & 0xFF) << 8) | ((modifiers) & 0xFF))
+
 // record used to detect duplicate events
 typedef struct LastDetailEvent
 {
@@ -44,7 +47,15 @@ static void unset_device_grab(BackendXCBDevice *device);
 
 static void set_detail_grab(BackendXCBDevice *device, BackendXCBDetailGrab *grab);
 static void unset_detail_grab(BackendXCBDevice *device, BackendXCBDetailGrab *grab);
+static xcb_input_xi_passive_grab_device_cookie_t request_detail_grab(BackendXCBDevice *device, BackendXCBDetailGrab *grab);
+static void resolve_detail_grab(BackendXCBDevice *device, BackendXCBDetailGrab *grab,
+                                xcb_input_xi_passive_grab_device_cookie_t cookie);
+static xcb_void_cookie_t request_detail_ungrab(BackendXCBDevice *device, BackendXCBDetailGrab *grab);
+static void resolve_detail_ungrab(BackendXCBDevice *device, BackendXCBDetailGrab *grab, xcb_void_cookie_t cookie);
+
+static BackendXCBDeviceEventResponse get_response(BackendXCBDevice *device, xcb_input_key_press_event_t *event);
 
+static gboolean callback_input(xcb_generic_event_t *event, gpointer device_ptr);
 static void callback_xcb(xcb_generic_event_t *event, gpointer device_ptr);
 static void callback_focus(gpointer device_ptr);
 
@@ -57,23 +68,26 @@ static BackendXCBDetailGrab GLOBAL_PASSIVE_GRAB = {
 
 // create a new device listener
 BackendXCBDevice *backend_xcb_device_new(BackendXCB *backend, xcb_input_device_id_t device_id,
-                                         guint32 event_mask, BackendXCBDeviceCallback callback, gpointer data)
+                                         guint32 event_mask, BackendXCBDeviceEventResponse response,
+                                         BackendXCBDeviceCallback callback, gpointer data)
 {
     BackendXCBDevice *device = g_new(BackendXCBDevice, 1);
 
     // add backend
     device->backend = backend;
+    device->input = backend_xcb_get_input(device->backend);
 
     // add device info
     device->device_id = device_id;
     device->event_mask = event_mask;
+    device->response = response;
 
     // add callback
     device->callback = callback;
     device->data = data;
 
-    // add x connection
-    device->connection = backend_xcb_get_connection(device->backend);
+    // add x connection, grabbed events are sent to the connection of the input thread
+    device->connection = backend_xcb_input_get_connection(device->input);
     device->root_window = backend_xcb_get_root_window(device->backend);
 
     // initialize grabs
@@ -87,6 +101,13 @@ BackendXCBDevice *backend_xcb_device_new(BackendXCB *backend, xcb_input_device_i
     // init last events
     device->last_events = g_hash_table_new_full(NULL, NULL, NULL, g_free);
 
+    // init relays, counted by detail, group and modifiers
+    g_mutex_init(&device->mutex);
+    device->relays = g_hash_table_new(NULL, NULL);
+
+    // answer the events on the input thread
+    backend_xcb_input_subscribe(device->input, device->event_mask, callback_input, device);
+
     // subscribe to the events
     backend_xcb_subscribe(device->backend,
                           BACKEND_XCB_EXTENSION_XINPUT, device->event_mask,
@@ -102,10 +123,15 @@ void backend_xcb_device_destroy(BackendXCBDevice *device)
     backend_xcb_unsubscribe(device->backend,
                             BACKEND_XCB_EXTENSION_XINPUT, device->event_mask,
                             callback_xcb, device);
+    backend_xcb_input_unsubscribe(device->input, device->event_mask, callback_input, device);
 
     // free last events
     g_hash_table_unref(device->last_events);
 
+    // free relays
+    g_hash_table_unref(device->relays);
+    g_mutex_clear(&device->mutex);
+
     // free
     g_free(device);
 }
@@ -193,6 +219,27 @@ void backend_xcb_device_ungrab_detail(BackendXCBDevice *device, guint32 detail,
     }
 }
 
+// let a detail pass through to the focused window while grabbed
+void backend_xcb_device_relay_detail(BackendXCBDevice *device, guint32 detail, guint32 modifiers, guint8 group)
+{
+    g_mutex_lock(&device->mutex);
+    guint count = GPOINTER_TO_UINT(g_hash_table_lookup(device->relays, RELAYS_KEY(detail, group, modifiers)));
+    g_hash_table_insert(device->relays, RELAYS_KEY(detail, group, modifiers), GUINT_TO_POINTER(count + 1));
+    g_mutex_unlock(&device->mutex);
+}
+
+// stop letting a detail pass through while grabbed
+void backend_xcb_device_unrelay_detail(BackendXCBDevice *device, guint32 detail, guint32 modifiers, guint8 group)
+{
+    g_mutex_lock(&device->mutex);
+    guint count = GPOINTER_TO_UINT(g_hash_table_lookup(device->relays, RELAYS_KEY(detail, group, modifiers)));
+    if (count > 1)
+        g_hash_table_insert(device->relays, RELAYS_KEY(detail, group, modifiers), GUINT_TO_POINTER(count - 1));
+    else
+        g_hash_table_remove(device->relays, RELAYS_KEY(detail, group, modifiers));
+    g_mutex_unlock(&device->mutex);
+}
+
 // apply the full device grab
 static void set_device_grab(BackendXCBDevice *device)
 {
@@ -255,23 +302,38 @@ static void unset_device_grab(BackendXCBDevice *device)
 // apply a passive detail grab
 static void set_detail_grab(BackendXCBDevice *device, BackendXCBDetailGrab *grab)
 {
-    // send request
-    xcb_input_xi_passive_grab_device_cookie_t cookie;
-    cookie = xcb_input_xi_passive_grab_device(device->connection,
-                                              XCB_CURRENT_TIME,
-                                              device->grab_window,
-                                              XCB_NONE,
-                                              grab->detail,
-                                              device->device_id,
-                                              1,
-                                              1,
-                                              XCB_INPUT_GRAB_TYPE_KEYCODE,
-                                              XCB_INPUT_GRAB_MODE_22_SYNC,
-                                              XCB_INPUT_GRAB_MODE_22_SYNC,
-                                              FALSE,
-                                              &device->event_mask,
-                                              &grab->modifiers);
+    resolve_detail_grab(device, grab, request_detail_grab(device, grab));
+}
 
+// remove a passive detail grab
+static void unset_detail_grab(BackendXCBDevice *device, BackendXCBDetailGrab *grab)
+{
+    resolve_detail_ungrab(device, grab, request_detail_ungrab(device, grab));
+}
+
+// send a passive detail grab request without waiting for the reply
+static xcb_input_xi_passive_grab_device_cookie_t request_detail_grab(BackendXCBDevice *device, BackendXCBDetailGrab *grab)
+{
+    return xcb_input_xi_passive_grab_device(device->connection,
+                                            XCB_CURRENT_TIME,
+                                            device->grab_window,
+                                            XCB_NONE,
+                                            grab->detail,
+                                            device->device_id,
+                                            1,
+                                            1,
+                                            XCB_INPUT_GRAB_TYPE_KEYCODE,
+                                            XCB_INPUT_GRAB_MODE_22_SYNC,
+                                            XCB_INPUT_GRAB_MODE_22_SYNC,
+                                            FALSE,
+                                            &device->event_mask,
+                                            &grab->modifiers);
+}
+
+// wait for the reply of a passive detail grab request
+static void resolve_detail_grab(BackendXCBDevice *device, BackendXCBDetailGrab *grab,
+                                xcb_input_xi_passive_grab_device_cookie_t cookie)
+{
     // get response
     xcb_generic_error_t *error = NULL;
     xcb_input_xi_passive_grab_device_reply_t *reply = NULL;
@@ -286,19 +348,21 @@ static void set_detail_grab(BackendXCBDevice *device, BackendXCBDetailGrab *grab
         free(reply);
 }
 
-// remove a passive detail grab
-static void unset_detail_grab(BackendXCBDevice *device, BackendXCBDetailGrab *grab)
+// send a passive detail ungrab request without waiting for the reply
+static xcb_void_cookie_t request_detail_ungrab(BackendXCBDevice *device, BackendXCBDetailGrab *grab)
 {
-    // send request
-    xcb_void_cookie_t cookie;
-    cookie = xcb_input_xi_passive_ungrab_device_checked(device->connection,
-                                                        device->grab_window,
-                                                        grab->detail,
-                                                        device->device_id,
-                                                        1,
-                                                        XCB_INPUT_GRAB_TYPE_KEYCODE,
-                                                        &grab->modifiers);
+    return xcb_input_xi_passive_ungrab_device_checked(device->connection,
+                                                      device->grab_window,
+                                                      grab->detail,
+                                                      device->device_id,
+                                                      1,
+                                                      XCB_INPUT_GRAB_TYPE_KEYCODE,
+                                                      &grab->modifiers);
+}
 
+// wait for the result of a passive detail ungrab request
+static void resolve_detail_ungrab(BackendXCBDevice *device, BackendXCBDetailGrab *grab, xcb_void_cookie_t cookie)
+{
     // get response
     xcb_generic_error_t *error = xcb_request_check(device->connection, cookie);
     if (error)
@@ -311,8 +375,23 @@ static void unset_detail_grab(BackendXCBDevice *device, BackendXCBDetailGrab *gr
     }
 }
 
-// callback for handling xinput events
-static void callback_xcb(xcb_generic_event_t *generic_event, gpointer device_ptr)
+// decide whether a grabbed event is consumed or relayed
+static BackendXCBDeviceEventResponse get_response(BackendXCBDevice *device, xcb_input_key_press_event_t *event)
+{
+    // same modifiers and group as the parsed state
+    guint8 modifiers = event->mods.base | event->mods.latched | event->mods.locked | event->mods.effective;
+    guint8 group = event->group.base | event->group.latched | event->group.locked | event->group.effective;
+
+    // relayed details pass through, everything else gets the device response
+    g_mutex_lock(&device->mutex);
+    gboolean relay = g_hash_table_contains(device->relays, RELAYS_KEY(event->detail, group, modifiers));
+    g_mutex_unlock(&device->mutex);
+
+    return (relay) ? BACKEND_XCB_DEVICE_EVENT_RELAY : device->response;
+}
+
+// callback for answering xinput events, run on the input thread
+static gboolean callback_input(xcb_generic_event_t *generic_event, gpointer device_ptr)
 {
     BackendXCBDevice *device = device_ptr;
 
@@ -331,10 +410,10 @@ static void callback_xcb(xcb_generic_event_t *generic_event, gpointer device_ptr
     gboolean is_duplicate = (event->time == last_event->time &&
                              event->event_type == last_event->event_type);
 
-    // only send the event if it is not a duplicate
+    // only decide on the event if it is not a duplicate
     BackendXCBDeviceEventResponse response;
     if (!is_duplicate)
-        response = device->callback(generic_event, device->data);
+        response = get_response(device, event);
     else
         response = last_event->response;
 
@@ -346,20 +425,29 @@ static void callback_xcb(xcb_generic_event_t *generic_event, gpointer device_ptr
     // consume or relay the event
     guint8 event_mode = (response == BACKEND_XCB_DEVICE_EVENT_CONSUME) ? XCB_INPUT_EVENT_MODE_ASYNC_DEVICE
                                                                        : XCB_INPUT_EVENT_MODE_REPLAY_DEVICE;
-    xcb_void_cookie_t cookie = xcb_input_xi_allow_events_checked(device->connection,
-                                                                 event->time,
-                                                                 event->deviceid,
-                                                                 event_mode,
-                                                                 0,
-                                                                 device->root_window);
-    xcb_generic_error_t *error = xcb_request_check(device->connection, cookie);
-    if (error)
-    {
-        g_warning("backend-xcb: Allow events failed: error %d", error->error_code);
-        free(error);
-    }
-    // todo: needed?
+    // the request is unchecked so the device is released without waiting on a round trip,
+    // any error is received and logged through the event source
+    xcb_input_xi_allow_events(device->connection,
+                              event->time,
+                              event->deviceid,
+                              event_mode,
+                              0,
+                              device->root_window);
+
+    // send the request now, the device stays frozen until it is received
     xcb_flush(device->connection);
+
+    // only pass the event on to the main thread once
+    return !is_duplicate;
+}
+
+// callback for handling xinput events passed on to the main thread
+static void callback_xcb(xcb_generic_event_t *generic_event, gpointer device_ptr)
+{
+    BackendXCBDevice *device = device_ptr;
+
+    // notify of the event
+    device->callback(generic_event, device->data);
 }
 
 // listen for focus events
@@ -377,22 +465,48 @@ static void callback_focus(gpointer device_ptr)
     if (grab_window == device->grab_window)
         return;
 
-    // unset the global grab
+    // get all the grabs to move
+    GList *grabs = g_list_copy(device->detail_grabs);
+#if USE_XCB_GLOBAL_PASSIVE_GRAB
+    if (device->device_grabs > 0)
+        grabs = g_list_prepend(grabs, &GLOBAL_PASSIVE_GRAB);
+#else
     if (device->device_grabs > 0)
         unset_device_grab(device);
+#endif
+    guint num_grabs = g_list_length(grabs);
 
-    // unset the detail grabs
-    for (GList *link = device->detail_grabs; link; link = link->next)
-        unset_detail_grab(device, link->data);
+    // send the ungrab requests for the old window
+    xcb_void_cookie_t *ungrab_cookies = g_new(xcb_void_cookie_t, num_grabs);
+    gint index = 0;
+    for (GList *link = grabs; link; link = link->next, index++)
+        ungrab_cookies[index] = request_detail_ungrab(device, link->data);
 
     // set the new grab window
     device->grab_window = grab_window;
 
-    // reset the global grab
+    // send the grab requests for the new window
+    xcb_input_xi_passive_grab_device_cookie_t *grab_cookies = g_new(xcb_input_xi_passive_grab_device_cookie_t, num_grabs);
+    index = 0;
+    for (GList *link = grabs; link; link = link->next, index++)
+        grab_cookies[index] = request_detail_grab(device, link->data);
+
+    // collect the replies, all requests are answered in a single round trip
+    index = 0;
+    for (GList *link = grabs; link; link = link->next, index++)
+        resolve_detail_ungrab(device, link->data, ungrab_cookies[index]);
+    index = 0;
+    for (GList *link = grabs; link; link = link->next, index++)
+        resolve_detail_grab(device, link->data, grab_cookies[index]);
+
+#if !USE_XCB_GLOBAL_PASSIVE_GRAB
+    // reset the device grab
     if (device->device_grabs > 0)
         set_device_grab(device);
+#endif
 
-    // reset the detail grabs
-    for (GList *link = device->detail_grabs; link; link = link->next)
-        set_detail_grab(device, link->data);
+    // free
+    g_free(ungrab_cookies);
+    g_free(grab_cookies);
+    g_list_free(grabs);
 }
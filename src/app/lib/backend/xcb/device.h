@@ -30,16 +30,18 @@ typedef enum BackendXCBDeviceEventResponse
     BACKEND_XCB_DEVICE_EVENT_CONSUME,
 } BackendXCBDeviceEventResponse;
 
-// callback for xcb device events
-typedef BackendXCBDeviceEventResponse (*BackendXCBDeviceCallback)(xcb_generic_event_t *generic_event, gpointer data);
+// callback for xcb device events, run on the main thread after the event is answered
+typedef void (*BackendXCBDeviceCallback)(xcb_generic_event_t *generic_event, gpointer data);
 
 // backend for listening and grabbing xcb device events
 typedef struct BackendXCBDevice
 {
     BackendXCB *backend;
+    BackendXCBInput *input;
 
     xcb_input_device_id_t device_id;
     guint32 event_mask;
+    BackendXCBDeviceEventResponse response;
 
     BackendXCBDeviceCallback callback;
     gpointer data;
@@ -54,13 +56,19 @@ typedef struct BackendXCBDevice
     xcb_window_t grab_window;
 
     GHashTable *last_events;
+
+    GMutex mutex;
+    GHashTable *relays;
 } BackendXCBDevice;
 
 BackendXCBDevice *backend_xcb_device_new(BackendXCB *backend, xcb_input_device_id_t device_id,
-                                         guint32 event_mask, BackendXCBDeviceCallback callback, gpointer data);
+                                         guint32 event_mask, BackendXCBDeviceEventResponse response,
+                                         BackendXCBDeviceCallback callback, gpointer data);
 void backend_xcb_device_destroy(BackendXCBDevice *device);
 void backend_xcb_device_grab(BackendXCBDevice *device);
 void backend_xcb_device_ungrab(BackendXCBDevice *device);
 void backend_xcb_device_grab_detail(BackendXCBDevice *device, guint32 detail, guint32 modifiers);
 void backend_xcb_device_ungrab_detail(BackendXCBDevice *device, guint32 detail, guint32 modifiers);
+void backend_xcb_device_relay_detail(BackendXCBDevice *device, guint32 detail, guint32 modifiers, guint8 group);
+void backend_xcb_device_unrelay_detail(BackendXCBDevice *device, guint32 detail, guint32 modifiers, guint8 group);
 #endif /* E0EEF1E6_8EE7_4E0E_94B1_7F1F3E5DAE25 */
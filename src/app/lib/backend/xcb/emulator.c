@@ -19,13 +19,17 @@
 
 #include "emulator.h"
 
+#include <string.h>
 #include <xcb/xtest.h>
 
 #include "utils.h"
 
+#define KEY_IS_DOWN(keys, keycode) ((keys)[(keycode) / 8] & (1 << ((keycode) % 8)))
+
 static gboolean emulate_modifiers(BackendXCBEmulator *emulator, guint8 modifiers);
-static gboolean emulate_move(BackendXCBEmulator *emulator, gint x, gint y);
-static gboolean emulate_detail(BackendXCBEmulator *emulator, guint8 type, guint8 detail, GHashTable *record);
+static void emulate_move(BackendXCBEmulator *emulator, gint x, gint y);
+static void emulate_detail(BackendXCBEmulator *emulator, guint8 type, guint8 detail, GHashTable *record);
+static void track_key(BackendXCBEmulator *emulator, guint8 keycode, gboolean pressed);
 static gboolean reset_details(BackendXCBEmulator *emulator, GHashTable *record);
 
 // create a new emulator listener
@@ -51,6 +55,10 @@ BackendXCBEmulator *backend_xcb_emulator_new(BackendXCB *backend)
     emulator->emulated_keys = g_hash_table_new(NULL, NULL);
     emulator->emulated_buttons = g_hash_table_new(NULL, NULL);
 
+    // init sequence
+    emulator->sequence_depth = 0;
+    emulator->sequence_mapping = NULL;
+
     // return
     return emulator;
 }
@@ -70,185 +78,208 @@ void backend_xcb_emulator_destroy(BackendXCBEmulator *emulator)
     g_free(emulator);
 }
 
-// reset any emulated keys or state
-gboolean backend_xcb_emulator_reset(BackendXCBEmulator *emulator)
+// begin a sequence of emulated events, they are sent without waiting and
+// submitted together on commit. sequences can be nested, only the outermost
+// one takes the state and submits
+gboolean backend_xcb_emulator_begin(BackendXCBEmulator *emulator)
 {
-    // reset any keys
-    if (!reset_details(emulator, emulator->emulated_keys))
-        return FALSE;
+    if (emulator->sequence_depth++ > 0)
+        return TRUE;
 
-    // reset any buttons
-    if (!reset_details(emulator, emulator->emulated_buttons))
+    // take the cached state, pressed keys and modifier mapping
+    emulator->sequence_state = backend_xcb_state_current(emulator->state);
+    backend_xcb_state_keys(emulator->state, emulator->sequence_keys);
+    emulator->sequence_mapping = backend_xcb_state_modifier_mapping(emulator->state);
+    if (!emulator->sequence_mapping)
+    {
+        emulator->sequence_depth--;
         return FALSE;
+    }
 
     // return success
     return TRUE;
 }
 
-// set an emulated state
-gboolean backend_xcb_emulator_state(BackendXCBEmulator *emulator, BackendStateEvent state)
+// commit a sequence of emulated events, flushing them and waiting until the
+// server has processed them. errors are logged by the backend as they arrive
+gboolean backend_xcb_emulator_commit(BackendXCBEmulator *emulator)
 {
-    // todo: emulate group
+    if (emulator->sequence_depth == 0 || --emulator->sequence_depth > 0)
+        return TRUE;
 
-    // emulate modifiers
-    if (!emulate_modifiers(emulator, state.modifiers))
-        return FALSE;
+    // the mapping is owned by the state
+    emulator->sequence_mapping = NULL;
 
-    // emulate pointer movement
-    if (!emulate_move(emulator, state.pointer_x, state.pointer_y))
+    // sync once for the whole sequence
+    xcb_get_input_focus_reply_t *reply;
+    reply = xcb_get_input_focus_reply(emulator->connection, xcb_get_input_focus(emulator->connection), NULL);
+    if (!reply)
+    {
+        g_warning("backend-xcb: Failed to submit emulated events");
         return FALSE;
+    }
+    free(reply);
 
     // return success
     return TRUE;
 }
 
+// reset any emulated keys or state
+gboolean backend_xcb_emulator_reset(BackendXCBEmulator *emulator)
+{
+    if (!backend_xcb_emulator_begin(emulator))
+        return FALSE;
+
+    // reset any keys and buttons
+    gboolean is_success = reset_details(emulator, emulator->emulated_keys);
+    is_success &= reset_details(emulator, emulator->emulated_buttons);
+
+    // submit
+    return backend_xcb_emulator_commit(emulator) && is_success;
+}
+
+// set an emulated state
+gboolean backend_xcb_emulator_state(BackendXCBEmulator *emulator, BackendStateEvent state)
+{
+    if (!backend_xcb_emulator_begin(emulator))
+        return FALSE;
+
+    // todo: emulate group
+
+    // emulate modifiers, then pointer movement
+    gboolean is_success = emulate_modifiers(emulator, state.modifiers);
+    if (is_success)
+        emulate_move(emulator, state.pointer_x, state.pointer_y);
+
+    // submit
+    return backend_xcb_emulator_commit(emulator) && is_success;
+}
+
 // emulate a keyboard event
 gboolean backend_xcb_emulator_key(BackendXCBEmulator *emulator, BackendKeyboardEvent event)
 {
-    // set the state
-    if (!backend_xcb_emulator_state(emulator, event.state))
+    if (!backend_xcb_emulator_begin(emulator))
         return FALSE;
 
-    // send the key event
-    if (!emulate_detail(emulator, (event.pressed) ? XCB_KEY_PRESS : XCB_KEY_RELEASE, event.keycode, emulator->emulated_keys))
-        return FALSE;
+    // set the state, then send the key event
+    gboolean is_success = backend_xcb_emulator_state(emulator, event.state);
+    if (is_success)
+        emulate_detail(emulator, (event.pressed) ? XCB_KEY_PRESS : XCB_KEY_RELEASE, event.keycode, emulator->emulated_keys);
 
-    // return success
-    return TRUE;
+    // submit
+    return backend_xcb_emulator_commit(emulator) && is_success;
 }
 
 // emulate a mouse event
 gboolean backend_xcb_emulator_button(BackendXCBEmulator *emulator, BackendPointerEvent event)
 {
-    // set the state
-    if (!backend_xcb_emulator_state(emulator, event.state))
+    if (!backend_xcb_emulator_begin(emulator))
         return FALSE;
 
-    // send the key event
-    if (!emulate_detail(emulator, (event.pressed) ? XCB_BUTTON_PRESS : XCB_BUTTON_RELEASE, event.button, emulator->emulated_buttons))
-        return FALSE;
+    // set the state, then send the button event
+    gboolean is_success = backend_xcb_emulator_state(emulator, event.state);
+    if (is_success)
+        emulate_detail(emulator, (event.pressed) ? XCB_BUTTON_PRESS : XCB_BUTTON_RELEASE, event.button, emulator->emulated_buttons);
 
-    // return success
-    return TRUE;
+    // submit
+    return backend_xcb_emulator_commit(emulator) && is_success;
 }
 
-// emulate the set of modifierse
+// emulate the set of modifiers, using the state and mapping of the sequence
+// instead of checking the state after every key
 static gboolean emulate_modifiers(BackendXCBEmulator *emulator, guint8 modifiers)
 {
-    // get current state
-    BackendStateEvent current_state = backend_xcb_state_current(emulator->state);
-
-    // send get modifiers mapping request
-    xcb_input_get_device_modifier_mapping_cookie_t cookie;
-    cookie = xcb_input_get_device_modifier_mapping(emulator->connection, emulator->keyboard_id);
-
-    // get the reply
-    xcb_generic_error_t *error = NULL;
-    xcb_input_get_device_modifier_mapping_reply_t *reply;
-    reply = xcb_input_get_device_modifier_mapping_reply(emulator->connection, cookie, &error);
-    if (error)
-    {
-        g_warning("backend-xcb: Failed to get modifier mapping: error: %d", error->error_code);
-        free(error);
-        return FALSE;
-    }
-    if (!reply)
-        return FALSE;
-
-    // get the maps
-    guint8 *modifier_keycodes = xcb_input_get_device_modifier_mapping_keymaps(reply);
+    xcb_input_get_device_modifier_mapping_reply_t *mapping = emulator->sequence_mapping;
+    guint8 *modifier_keycodes = xcb_input_get_device_modifier_mapping_keymaps(mapping);
 
     // check all the modifiers
     gboolean is_success = TRUE;
-    for (gint mod_index = 0; mod_index <= 8; mod_index++)
+    for (gint mod_index = 0; mod_index < 8; mod_index++)
     {
+        guint8 mask = 1 << mod_index;
+
         // do nothing if already matches
-        if ((modifiers & (1 << mod_index)) == (current_state.modifiers & (1 << mod_index)))
+        if ((modifiers & mask) == (emulator->sequence_state.modifiers & mask))
             continue;
 
         // get modifier action
-        gboolean press = (modifiers & (1 << mod_index)) && !(current_state.modifiers & (1 << mod_index));
+        gboolean press = modifiers & mask;
 
-        // try sending keycodes to set the modifier
-        for (gint keycode_index = 0; keycode_index < reply->keycodes_per_modifier; keycode_index++)
+        // press the first free key of the modifier, or release all the held ones
+        gboolean is_set = FALSE;
+        for (gint keycode_index = 0; keycode_index < mapping->keycodes_per_modifier; keycode_index++)
         {
             // get the keycode
-            guint keycode = modifier_keycodes[mod_index * reply->keycodes_per_modifier + keycode_index];
+            guint8 keycode = modifier_keycodes[mod_index * mapping->keycodes_per_modifier + keycode_index];
             if (!keycode)
                 continue;
 
             // send key
-            emulate_detail(emulator, (press) ? XCB_KEY_PRESS : XCB_KEY_RELEASE, keycode, emulator->emulated_keys);
-
-            // check if was set
-            current_state = backend_xcb_state_current(emulator->state);
-            if ((modifiers & (1 << mod_index)) == (current_state.modifiers & (1 << mod_index)))
+            gboolean is_down = KEY_IS_DOWN(emulator->sequence_keys, keycode);
+            if (press && !is_down)
+            {
+                emulate_detail(emulator, XCB_KEY_PRESS, keycode, emulator->emulated_keys);
+                is_set = TRUE;
                 break;
-            else
-                emulate_detail(emulator, (!press) ? XCB_KEY_PRESS : XCB_KEY_RELEASE, keycode, emulator->emulated_keys);
+            }
+            if (!press && is_down)
+            {
+                emulate_detail(emulator, XCB_KEY_RELEASE, keycode, emulator->emulated_keys);
+                is_set = TRUE;
+            }
         }
 
-        // check if modifier was set
-        if ((modifiers & (1 << mod_index)) != (current_state.modifiers & (1 << mod_index)))
+        // check if modifier was set, locked modifiers can't be released by keys
+        if (!is_set)
+        {
+            g_warning("backend-xcb: Failed to %s modifier: index: %d", (press) ? "set" : "unset", mod_index);
             is_success = FALSE;
+        }
     }
 
     // return
-    free(reply);
     return is_success;
 }
 
-// emulate the mouse movement
-static gboolean emulate_move(BackendXCBEmulator *emulator, gint x, gint y)
+// emulate the mouse movement, if the pointer is not already there
+static void emulate_move(BackendXCBEmulator *emulator, gint x, gint y)
 {
-    // send request
-    xcb_void_cookie_t cookie;
-    cookie = xcb_input_xi_warp_pointer_checked(emulator->connection,
-                                               XCB_NONE,
-                                               emulator->root_window,
-                                               0, 0,
-                                               0, 0,
-                                               x << 16, y << 16,
-                                               emulator->pointer_id);
-
-    // get response
-    xcb_generic_error_t *error = xcb_request_check(emulator->connection, cookie);
-    if (error)
-    {
-        g_warning("backend-xcb: Failed to warp pointer: error: %d", error->error_code);
-        free(error);
-        return FALSE;
-    }
+    if (emulator->sequence_state.pointer_x == x && emulator->sequence_state.pointer_y == y)
+        return;
 
-    // return success
-    return TRUE;
+    // send request
+    xcb_input_xi_warp_pointer(emulator->connection,
+                              XCB_NONE,
+                              emulator->root_window,
+                              0, 0,
+                              0, 0,
+                              x << 16, y << 16,
+                              emulator->pointer_id);
+
+    // track the position, warps are not seen by the state
+    emulator->sequence_state.pointer_x = x;
+    emulator->sequence_state.pointer_y = y;
+    backend_xcb_state_pointer_moved(emulator->state);
 }
 
 // emulate an input event
-static gboolean emulate_detail(BackendXCBEmulator *emulator, guint8 type, guint8 detail, GHashTable *record)
+static void emulate_detail(BackendXCBEmulator *emulator, guint8 type, guint8 detail, GHashTable *record)
 {
     g_debug("backend-xcb: Emulating detail: type: %d, detail: %d", type, detail);
 
     // send key
-    xcb_void_cookie_t cookie;
     // todo: deviceid can apparently be 0, will that still get picked up by grabs?
-    cookie = xcb_test_fake_input_checked(emulator->connection,
-                                         type,
-                                         detail,
-                                         XCB_CURRENT_TIME,
-                                         emulator->root_window,
-                                         0, 0,
-                                         emulator->keyboard_id);
-
-    // check response
-    xcb_generic_error_t *error = xcb_request_check(emulator->connection, cookie);
-    if (error)
-    {
-        g_warning("backend-xcb: Key emulation failed: type: %d, detail: %d, error %d",
-                  type, detail, error->error_code);
-        free(error);
-        return FALSE;
-    }
+    xcb_test_fake_input(emulator->connection,
+                        type,
+                        detail,
+                        XCB_CURRENT_TIME,
+                        emulator->root_window,
+                        0, 0,
+                        emulator->keyboard_id);
+
+    // track the pressed keys
+    if (type == XCB_KEY_PRESS || type == XCB_KEY_RELEASE)
+        track_key(emulator, detail, type == XCB_KEY_PRESS);
 
     // record in emulation table
     if (record)
@@ -263,9 +294,39 @@ static gboolean emulate_detail(BackendXCBEmulator *emulator, guint8 type, guint8
             g_hash_table_insert(record, GUINT_TO_POINTER(detail), GUINT_TO_POINTER(type));
         }
     }
+}
 
-    // return success
-    return TRUE;
+// track a key of the sequence and the modifiers held by it, a locking modifier
+// is treated like any other and only known to be locked from the initial state
+static void track_key(BackendXCBEmulator *emulator, guint8 keycode, gboolean pressed)
+{
+    // set the key
+    if (pressed)
+        emulator->sequence_keys[keycode / 8] |= 1 << (keycode % 8);
+    else
+        emulator->sequence_keys[keycode / 8] &= ~(1 << (keycode % 8));
+
+    // set the modifiers held by any of their keys
+    xcb_input_get_device_modifier_mapping_reply_t *mapping = emulator->sequence_mapping;
+    guint8 *modifier_keycodes = xcb_input_get_device_modifier_mapping_keymaps(mapping);
+    for (gint mod_index = 0; mod_index < 8; mod_index++)
+    {
+        // skip modifiers this key is not mapped to
+        guint8 *keycodes = modifier_keycodes + mod_index * mapping->keycodes_per_modifier;
+        if (!memchr(keycodes, keycode, mapping->keycodes_per_modifier))
+            continue;
+
+        // check if any key of the modifier is held
+        gboolean is_held = FALSE;
+        for (gint keycode_index = 0; keycode_index < mapping->keycodes_per_modifier; keycode_index++)
+            is_held |= keycodes[keycode_index] && KEY_IS_DOWN(emulator->sequence_keys, keycodes[keycode_index]);
+
+        // update the modifier
+        if (is_held)
+            emulator->sequence_state.modifiers |= 1 << mod_index;
+        else
+            emulator->sequence_state.modifiers &= ~(1 << mod_index);
+    }
 }
 
 static gboolean reset_details(BackendXCBEmulator *emulator, GHashTable *record)
@@ -283,16 +344,16 @@ static gboolean reset_details(BackendXCBEmulator *emulator, GHashTable *record)
         switch (GPOINTER_TO_UINT(type_ptr))
         {
         case XCB_KEY_PRESS:
-            is_success &= emulate_detail(emulator, XCB_KEY_RELEASE, GPOINTER_TO_UINT(detail_ptr), NULL);
+            emulate_detail(emulator, XCB_KEY_RELEASE, GPOINTER_TO_UINT(detail_ptr), NULL);
             break;
         case XCB_KEY_RELEASE:
-            is_success &= emulate_detail(emulator, XCB_KEY_PRESS, GPOINTER_TO_UINT(detail_ptr), NULL);
+            emulate_detail(emulator, XCB_KEY_PRESS, GPOINTER_TO_UINT(detail_ptr), NULL);
             break;
         case XCB_BUTTON_PRESS:
-            is_success &= emulate_detail(emulator, XCB_BUTTON_RELEASE, GPOINTER_TO_UINT(detail_ptr), NULL);
+            emulate_detail(emulator, XCB_BUTTON_RELEASE, GPOINTER_TO_UINT(detail_ptr), NULL);
             break;
         case XCB_BUTTON_RELEASE:
-            is_success &= emulate_detail(emulator, XCB_BUTTON_PRESS, GPOINTER_TO_UINT(detail_ptr), NULL);
+            emulate_detail(emulator, XCB_BUTTON_PRESS, GPOINTER_TO_UINT(detail_ptr), NULL);
             break;
         default:
             is_success = FALSE;
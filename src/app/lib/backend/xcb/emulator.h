@@ -41,10 +41,17 @@ typedef struct BackendXCBEmulator
 
     GHashTable *emulated_keys;
     GHashTable *emulated_buttons;
+
+    guint sequence_depth;
+    BackendStateEvent sequence_state;
+    guint8 sequence_keys[32];
+    xcb_input_get_device_modifier_mapping_reply_t *sequence_mapping;
 } BackendXCBEmulator;
 
 BackendXCBEmulator *backend_xcb_emulator_new(BackendXCB *backend);
 void backend_xcb_emulator_destroy(BackendXCBEmulator *emulator);
+gboolean backend_xcb_emulator_begin(BackendXCBEmulator *emulator);
+gboolean backend_xcb_emulator_commit(BackendXCBEmulator *emulator);
 gboolean backend_xcb_emulator_reset(BackendXCBEmulator *emulator);
 gboolean backend_xcb_emulator_state(BackendXCBEmulator *emulator, BackendStateEvent state);
 gboolean backend_xcb_emulator_key(BackendXCBEmulator *emulator, BackendKeyboardEvent event);
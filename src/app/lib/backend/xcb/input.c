@@ -0,0 +1,335 @@
+/**
+ * Copyright (C) 2021 Ryan Britton
+ *
+ * This file is part of Goodnight Mouse.
+ *
+ * Goodnight Mouse is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Goodnight Mouse is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Goodnight Mouse.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "input.h"
+
+#include "source.h"
+
+// subscriber to events on the input thread
+typedef struct Subscriber
+{
+    guint32 event_mask;
+    BackendXCBInputCallback callback;
+    gpointer data;
+} Subscriber;
+
+// source that hands queued events to the main thread
+typedef struct InputSource
+{
+    GSource source;
+    BackendXCBInput *input;
+} InputSource;
+
+static gpointer input_thread_run(gpointer input_ptr);
+static gboolean input_thread_filter(BackendXCBInput *input, xcb_generic_event_t *event);
+static void input_thread_push(BackendXCBInput *input, xcb_generic_event_t *event);
+static void input_thread_wake(BackendXCBInput *input);
+
+static gboolean input_source_prepare(GSource *source, gint *timeout);
+static gboolean input_source_check(GSource *source);
+static gboolean input_source_dispatch(GSource *source, GSourceFunc callback, gpointer user_data);
+
+static GSourceFuncs input_source_funcs = {
+    .prepare = input_source_prepare,
+    .check = input_source_check,
+    .dispatch = input_source_dispatch,
+    .finalize = NULL,
+};
+
+// create a new input thread listening to xinput events
+BackendXCBInput *backend_xcb_input_new(guint32 event_mask)
+{
+    BackendXCBInput *input = g_new(BackendXCBInput, 1);
+
+    // open a separate x connection, only used by the input thread and for grabs
+    input->connection = xcb_connect(NULL, NULL);
+    const xcb_setup_t *setup = xcb_get_setup(input->connection);
+    xcb_screen_t *screen = xcb_setup_roots_iterator(setup).data;
+    input->root_window = screen->root;
+
+    // get xinput op code
+    const xcb_query_extension_reply_t *xinput_reply = xcb_get_extension_data(input->connection, &xcb_input_id);
+    if (!xinput_reply || !xinput_reply->present)
+        g_error("backend-xcb: XInputExtension not found");
+    input->extension_xinput = xinput_reply->major_opcode;
+
+    // ask for xinput 2.2, so raw events are delivered while devices are grabbed
+    free(xcb_input_xi_query_version_reply(input->connection, xcb_input_xi_query_version(input->connection, 2, 2), NULL));
+
+    // select xinput events
+    struct
+    {
+        xcb_input_event_mask_t head;
+        xcb_input_xi_event_mask_t mask;
+    } xinput_mask;
+    xinput_mask.head.deviceid = XCB_INPUT_DEVICE_ALL;
+    xinput_mask.head.mask_len = sizeof(xinput_mask.mask) / sizeof(uint32_t);
+    xinput_mask.mask = event_mask;
+    xcb_input_xi_select_events(input->connection, input->root_window, 1, &xinput_mask.head);
+
+    // create a window to send the thread a message when stopping
+    input->wake_window = xcb_generate_id(input->connection);
+    xcb_create_window(input->connection, XCB_COPY_FROM_PARENT, input->wake_window, input->root_window,
+                      0, 0, 1, 1, 0, XCB_WINDOW_CLASS_INPUT_ONLY, XCB_COPY_FROM_PARENT, 0, NULL);
+    xcb_flush(input->connection);
+
+    // init subscribers
+    g_mutex_init(&input->mutex);
+    input->subscribers = NULL;
+
+    // init the event queue
+    input->queue_head = 0;
+    input->queue_tail = 0;
+    input->queue_dropped = 0;
+
+    // create the source for the main thread, attached by the owner
+    input->source = g_source_new(&input_source_funcs, sizeof(InputSource));
+    ((InputSource *)input->source)->input = input;
+
+    // start the thread
+    input->running = TRUE;
+    input->thread = g_thread_new("backend-xcb-input", input_thread_run, input);
+
+    // return
+    return input;
+}
+
+// stop and destroy the input thread
+void backend_xcb_input_destroy(BackendXCBInput *input)
+{
+    // stop the thread
+    g_atomic_int_set(&input->running, FALSE);
+    input_thread_wake(input);
+    g_thread_join(input->thread);
+
+    // remove source
+    g_source_destroy(input->source);
+    g_source_unref(input->source);
+
+    // free events not handled by the main thread
+    for (gint index = input->queue_head; index != input->queue_tail; index = (index + 1) % BACKEND_XCB_INPUT_QUEUE_SIZE)
+        free(input->queue[index]);
+
+    // close connection
+    xcb_destroy_window(input->connection, input->wake_window);
+    xcb_disconnect(input->connection);
+
+    // free subscribers
+    g_list_free_full(input->subscribers, g_free);
+    g_mutex_clear(&input->mutex);
+
+    // free
+    g_free(input);
+}
+
+// subscribe to xinput events on the input thread
+void backend_xcb_input_subscribe(BackendXCBInput *input, guint32 event_mask, BackendXCBInputCallback callback, gpointer data)
+{
+    // create new subscriber
+    Subscriber *subscriber = g_new(Subscriber, 1);
+    subscriber->event_mask = event_mask;
+    subscriber->callback = callback;
+    subscriber->data = data;
+
+    // add the subscriber
+    g_mutex_lock(&input->mutex);
+    input->subscribers = g_list_append(input->subscribers, subscriber);
+    g_mutex_unlock(&input->mutex);
+}
+
+// unsubscribe from xinput events, the callback is not running once this returns
+void backend_xcb_input_unsubscribe(BackendXCBInput *input, guint32 event_mask, BackendXCBInputCallback callback, gpointer data)
+{
+    g_mutex_lock(&input->mutex);
+
+    // remove the first matching subscriber
+    for (GList *link = input->subscribers; link; link = link->next)
+    {
+        Subscriber *subscriber = link->data;
+
+        // check if subscriber matches
+        if (!(subscriber->event_mask == event_mask &&
+              subscriber->callback == callback &&
+              subscriber->data == data))
+            continue;
+
+        // remove subscriber
+        input->subscribers = g_list_delete_link(input->subscribers, link);
+        g_free(subscriber);
+        break;
+    }
+
+    g_mutex_unlock(&input->mutex);
+}
+
+// get the xcb connection of the input thread
+xcb_connection_t *backend_xcb_input_get_connection(BackendXCBInput *input)
+{
+    return input->connection;
+}
+
+// get the source dispatching events passed to the main thread
+GSource *backend_xcb_input_get_source(BackendXCBInput *input)
+{
+    return input->source;
+}
+
+// read events until stopped
+static gpointer input_thread_run(gpointer input_ptr)
+{
+    BackendXCBInput *input = input_ptr;
+
+    while (g_atomic_int_get(&input->running))
+    {
+        // wait for the next event
+        xcb_generic_event_t *event = xcb_wait_for_event(input->connection);
+        if (!event)
+        {
+            g_warning("backend-xcb: Input connection closed: error: %d", xcb_connection_has_error(input->connection));
+            break;
+        }
+
+        // handle the event and pass it on if needed
+        if (input_thread_filter(input, event))
+            input_thread_push(input, event);
+        else
+            free(event);
+    }
+
+    return NULL;
+}
+
+// run the input thread subscribers, returns whether the main thread should get the event
+static gboolean input_thread_filter(BackendXCBInput *input, xcb_generic_event_t *event)
+{
+    // drop the stop message
+    guint8 type = event->response_type & ~0x80;
+    if (type == XCB_CLIENT_MESSAGE && ((xcb_client_message_event_t *)event)->window == input->wake_window)
+        return FALSE;
+
+    // pass on everything that is not an xinput event, including errors
+    if (type != XCB_GE_GENERIC || ((xcb_ge_generic_event_t *)event)->extension != input->extension_xinput)
+        return TRUE;
+    guint16 event_type = ((xcb_ge_generic_event_t *)event)->event_type;
+
+    // pass on the event unless a subscriber handled it completely
+    gboolean pass = TRUE;
+    g_mutex_lock(&input->mutex);
+    for (GList *link = input->subscribers; link; link = link->next)
+    {
+        Subscriber *subscriber = link->data;
+        if (event_type < 32 && (subscriber->event_mask & (1u << event_type)))
+            pass = subscriber->callback(event, subscriber->data) && pass;
+    }
+    g_mutex_unlock(&input->mutex);
+
+    return pass;
+}
+
+// add an event to the queue, only called by the input thread. the event is
+// dropped if the main thread has fallen behind, as waiting for room would stop
+// the thread from answering grabs. the devices are already released by then
+static void input_thread_push(BackendXCBInput *input, xcb_generic_event_t *event)
+{
+    gint tail = input->queue_tail;
+    gint next_tail = (tail + 1) % BACKEND_XCB_INPUT_QUEUE_SIZE;
+
+    // drop the event if the queue is full
+    if (next_tail == g_atomic_int_get(&input->queue_head))
+    {
+        if (input->queue_dropped++ == 0)
+            g_warning("backend-xcb: Input queue full, dropping events");
+        free(event);
+        return;
+    }
+
+    // report the events dropped once there is room again
+    if (input->queue_dropped)
+    {
+        g_debug("backend-xcb: Dropped %u input events", input->queue_dropped);
+        input->queue_dropped = 0;
+    }
+
+    // publish the event
+    input->queue[tail] = event;
+    g_atomic_int_set(&input->queue_tail, next_tail);
+
+    // wake the main loop, the source is attached to the default context
+    g_main_context_wakeup(NULL);
+}
+
+// wake the input thread by sending a message to itself
+static void input_thread_wake(BackendXCBInput *input)
+{
+    xcb_client_message_event_t event = {0};
+    event.response_type = XCB_CLIENT_MESSAGE;
+    event.format = 32;
+    event.window = input->wake_window;
+    event.type = XCB_ATOM_NONE;
+
+    // with no event mask the message goes to the window creator
+    xcb_send_event(input->connection, FALSE, input->wake_window, XCB_EVENT_MASK_NO_EVENT, (const char *)&event);
+    xcb_flush(input->connection);
+}
+
+// input source prepare
+static gboolean input_source_prepare(GSource *source, gint *timeout)
+{
+    // timeout doesn't matter
+    *timeout = -1;
+
+    // return whether events are queued
+    return input_source_check(source);
+}
+
+// input source check
+static gboolean input_source_check(GSource *source)
+{
+    BackendXCBInput *input = ((InputSource *)source)->input;
+    return input->queue_head != g_atomic_int_get(&input->queue_tail);
+}
+
+// input source dispatch all queued events
+static gboolean input_source_dispatch(GSource *source, GSourceFunc callback, gpointer data)
+{
+    BackendXCBInput *input = ((InputSource *)source)->input;
+
+    // do nothing if no callback
+    if (!callback)
+        return G_SOURCE_CONTINUE;
+
+    // dispatch the events queued so far
+    gboolean state = G_SOURCE_CONTINUE;
+    gint tail = g_atomic_int_get(&input->queue_tail);
+    while (input->queue_head != tail && state == G_SOURCE_CONTINUE)
+    {
+        // pop the event, giving the slot back to the input thread
+        xcb_generic_event_t *event = input->queue[input->queue_head];
+        g_atomic_int_set(&input->queue_head, (input->queue_head + 1) % BACKEND_XCB_INPUT_QUEUE_SIZE);
+
+        // call the callback
+        state = ((XCBSourceCallback)callback)(event, data);
+
+        // free event
+        free(event);
+    }
+
+    // return
+    return state;
+}
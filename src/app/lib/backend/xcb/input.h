@@ -0,0 +1,62 @@
+/**
+ * Copyright (C) 2021 Ryan Britton
+ *
+ * This file is part of Goodnight Mouse.
+ *
+ * Goodnight Mouse is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Goodnight Mouse is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Goodnight Mouse.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef E0EC2A24_4EB8_4692_89A3_7FECF8A276E3
+#define E0EC2A24_4EB8_4692_89A3_7FECF8A276E3
+
+#include <glib.h>
+#include <xcb/xcb.h>
+#include <xcb/xinput.h>
+
+// number of events that can wait to be handled by the main thread
+#define BACKEND_XCB_INPUT_QUEUE_SIZE (256)
+
+// callback run on the input thread for an xinput event, returns whether the event
+// should also be passed to the main thread
+typedef gboolean (*BackendXCBInputCallback)(xcb_generic_event_t *event, gpointer data);
+
+// thread with its own x connection that receives xinput events and answers grabs,
+// so devices are not left frozen while the main loop is busy
+typedef struct BackendXCBInput
+{
+    xcb_connection_t *connection;
+    xcb_window_t root_window;
+    xcb_window_t wake_window;
+    uint8_t extension_xinput;
+
+    GThread *thread;
+    gint running;
+
+    GMutex mutex;
+    GList *subscribers;
+
+    xcb_generic_event_t *queue[BACKEND_XCB_INPUT_QUEUE_SIZE];
+    gint queue_head;
+    gint queue_tail;
+    guint queue_dropped;
+    GSource *source;
+} BackendXCBInput;
+
+BackendXCBInput *backend_xcb_input_new(guint32 event_mask);
+void backend_xcb_input_destroy(BackendXCBInput *input);
+void backend_xcb_input_subscribe(BackendXCBInput *input, guint32 event_mask, BackendXCBInputCallback callback, gpointer data);
+void backend_xcb_input_unsubscribe(BackendXCBInput *input, guint32 event_mask, BackendXCBInputCallback callback, gpointer data);
+xcb_connection_t *backend_xcb_input_get_connection(BackendXCBInput *input);
+GSource *backend_xcb_input_get_source(BackendXCBInput *input);
+#endif /* E0EC2A24_4EB8_4692_89A3_7FECF8A276E3 */
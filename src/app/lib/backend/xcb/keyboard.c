@@ -21,7 +21,7 @@
 
 #include "utils.h"
 
-static BackendXCBDeviceEventResponse callback_device(xcb_generic_event_t *generic_event, gpointer keyboard_ptr);
+static void callback_device(xcb_generic_event_t *generic_event, gpointer keyboard_ptr);
 
 // create a new keyboard listener
 BackendXCBKeyboard *backend_xcb_keyboard_new(BackendXCB *backend, BackendKeyboardCallback callback, gpointer data)
@@ -44,6 +44,7 @@ BackendXCBKeyboard *backend_xcb_keyboard_new(BackendXCB *backend, BackendKeyboar
     keyboard->device = backend_xcb_device_new(keyboard->backend,
                                               keyboard_id,
                                               (XCB_INPUT_XI_EVENT_MASK_KEY_PRESS | XCB_INPUT_XI_EVENT_MASK_KEY_RELEASE),
+                                              BACKEND_XCB_DEVICE_EVENT_CONSUME,
                                               callback_device,
                                               keyboard);
 
@@ -93,8 +94,20 @@ void backend_xcb_keyboard_ungrab_key(BackendXCBKeyboard *keyboard, guint keycode
     backend_xcb_device_ungrab_detail(keyboard->device, keycode, state.modifiers);
 }
 
+// let a key pass through to the focused window while grabbed
+void backend_xcb_keyboard_relay_key(BackendXCBKeyboard *keyboard, guint keycode, BackendStateEvent state)
+{
+    backend_xcb_device_relay_detail(keyboard->device, keycode, state.modifiers, state.group);
+}
+
+// stop letting a key pass through while grabbed
+void backend_xcb_keyboard_unrelay_key(BackendXCBKeyboard *keyboard, guint keycode, BackendStateEvent state)
+{
+    backend_xcb_device_unrelay_detail(keyboard->device, keycode, state.modifiers, state.group);
+}
+
 // callback for handling key events
-static BackendXCBDeviceEventResponse callback_device(xcb_generic_event_t *generic_event, gpointer keyboard_ptr)
+static void callback_device(xcb_generic_event_t *generic_event, gpointer keyboard_ptr)
 {
     BackendXCBKeyboard *keyboard = keyboard_ptr;
 
@@ -108,9 +121,5 @@ static BackendXCBDeviceEventResponse callback_device(xcb_generic_event_t *generi
     event.state = backend_xcb_state_parse(keyboard->state, key_event->mods, key_event->group, key_event->root_x, key_event->root_y);
 
     // send the event
-    BackendKeyboardEventResponse response = keyboard->callback(event, keyboard->data);
-
-    // return the response
-    return (response == BACKEND_KEYBOARD_EVENT_CONSUME) ? BACKEND_XCB_DEVICE_EVENT_CONSUME
-                                                        : BACKEND_XCB_DEVICE_EVENT_RELAY;
+    keyboard->callback(event, keyboard->data);
 }
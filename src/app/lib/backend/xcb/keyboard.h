@@ -45,4 +45,6 @@ void backend_xcb_keyboard_grab(BackendXCBKeyboard *keyboard);
 void backend_xcb_keyboard_ungrab(BackendXCBKeyboard *keyboard);
 void backend_xcb_keyboard_grab_key(BackendXCBKeyboard *keyboard, guint keycode, BackendStateEvent state);
 void backend_xcb_keyboard_ungrab_key(BackendXCBKeyboard *keyboard, guint keycode, BackendStateEvent state);
+void backend_xcb_keyboard_relay_key(BackendXCBKeyboard *keyboard, guint keycode, BackendStateEvent state);
+void backend_xcb_keyboard_unrelay_key(BackendXCBKeyboard *keyboard, guint keycode, BackendStateEvent state);
 #endif /* FE6265C6_BCF0_41C2_B201_D16783856EB7 */
@@ -21,7 +21,7 @@
 
 #include "utils.h"
 
-static BackendXCBDeviceEventResponse callback_device(xcb_generic_event_t *generic_event, gpointer pointer_ptr);
+static void callback_device(xcb_generic_event_t *generic_event, gpointer pointer_ptr);
 
 // create a new pointer listener
 BackendXCBPointer *backend_xcb_pointer_new(BackendXCB *backend, BackendPointerCallback callback, gpointer data)
@@ -44,6 +44,7 @@ BackendXCBPointer *backend_xcb_pointer_new(BackendXCB *backend, BackendPointerCa
     pointer->device = backend_xcb_device_new(pointer->backend,
                                              pointer_id,
                                              (XCB_INPUT_XI_EVENT_MASK_BUTTON_PRESS | XCB_INPUT_XI_EVENT_MASK_BUTTON_RELEASE),
+                                             BACKEND_XCB_DEVICE_EVENT_RELAY,
                                              callback_device,
                                              pointer);
 
@@ -94,7 +95,7 @@ void backend_xcb_pointer_ungrab_button(BackendXCBPointer *pointer, guint button,
 }
 
 // callback for handling button events
-static BackendXCBDeviceEventResponse callback_device(xcb_generic_event_t *generic_event, gpointer pointer_ptr)
+static void callback_device(xcb_generic_event_t *generic_event, gpointer pointer_ptr)
 {
     BackendXCBPointer *pointer = pointer_ptr;
 
@@ -108,9 +109,5 @@ static BackendXCBDeviceEventResponse callback_device(xcb_generic_event_t *generi
     event.state = backend_xcb_state_parse(pointer->state, button_event->mods, button_event->group, button_event->root_x, button_event->root_y);
 
     // send the event
-    BackendPointerEventResponse response = pointer->callback(event, pointer->data);
-
-    // return the response
-    return (response == BACKEND_POINTER_EVENT_CONSUME) ? BACKEND_XCB_DEVICE_EVENT_CONSUME
-                                                       : BACKEND_XCB_DEVICE_EVENT_RELAY;
+    pointer->callback(event, pointer->data);
 }
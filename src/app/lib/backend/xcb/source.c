@@ -19,6 +19,9 @@
 
 #include "source.h"
 
+// maximum number of events held and dispatched per main loop iteration
+#define XCB_SOURCE_BATCH_SIZE (64)
+
 static gboolean xcb_source_prepare(GSource *source, gint *timeout);
 static gboolean xcb_source_check(GSource *source);
 static gboolean xcb_source_dispatch(GSource *source, GSourceFunc callback, gpointer user_data);
@@ -36,9 +39,14 @@ typedef struct XCBSource
     GSource source;
     xcb_connection_t *connection;
     GPollFD poll_fd;
-    GQueue *events;
+
+    xcb_generic_event_t *events[XCB_SOURCE_BATCH_SIZE];
+    guint events_head;
+    guint events_length;
 } XCBSource;
 
+static void xcb_source_read_events(XCBSource *xcb_source, gboolean read_socket);
+
 // create a new xcb event loop source
 GSource *xcb_source_new(xcb_connection_t *connection)
 {
@@ -54,8 +62,9 @@ GSource *xcb_source_new(xcb_connection_t *connection)
     xcb_source->poll_fd.events = G_IO_IN;
     g_source_add_poll(source, &xcb_source->poll_fd);
 
-    // create queue
-    xcb_source->events = g_queue_new();
+    // init the event ring
+    xcb_source->events_head = 0;
+    xcb_source->events_length = 0;
 
     // return
     return source;
@@ -72,8 +81,11 @@ static gboolean xcb_source_prepare(GSource *source, gint *timeout)
     // flush xcb
     xcb_flush(xcb_source->connection);
 
+    // take events xcb already read while waiting on replies, they won't wake the poll
+    xcb_source_read_events(xcb_source, FALSE);
+
     // return whether events exist
-    return !g_queue_is_empty(xcb_source->events);
+    return xcb_source->events_length > 0;
 }
 
 // xcb source check event loop
@@ -81,17 +93,11 @@ static gboolean xcb_source_check(GSource *source)
 {
     XCBSource *xcb_source = (XCBSource *)source;
 
-    // check the file descriptor
-    if (xcb_source->poll_fd.revents & G_IO_IN)
-    {
-        // read all pending events
-        xcb_generic_event_t *event;
-        while ((event = xcb_poll_for_event(xcb_source->connection)))
-            g_queue_push_tail(xcb_source->events, event);
-    }
+    // read the socket if it has data, otherwise only take queued events
+    xcb_source_read_events(xcb_source, xcb_source->poll_fd.revents & G_IO_IN);
 
     // return whether events are pending
-    return !g_queue_is_empty(xcb_source->events);
+    return xcb_source->events_length > 0;
 }
 
 // xcb source process event loop
@@ -103,14 +109,21 @@ static gboolean xcb_source_dispatch(GSource *source, GSourceFunc callback, gpoin
     if (!callback)
         return G_SOURCE_CONTINUE;
 
-    // get the event
-    xcb_generic_event_t *event = g_queue_pop_head(xcb_source->events);
+    // dispatch the whole batch of events
+    gboolean state = G_SOURCE_CONTINUE;
+    while (xcb_source->events_length > 0 && state == G_SOURCE_CONTINUE)
+    {
+        // pop the event
+        xcb_generic_event_t *event = xcb_source->events[xcb_source->events_head];
+        xcb_source->events_head = (xcb_source->events_head + 1) % XCB_SOURCE_BATCH_SIZE;
+        xcb_source->events_length--;
 
-    // call the callback
-    gboolean state = ((XCBSourceCallback)callback)(event, data);
+        // call the callback
+        state = ((XCBSourceCallback)callback)(event, data);
 
-    // free event
-    free(event);
+        // free event
+        free(event);
+    }
 
     // return
     return state;
@@ -121,6 +134,30 @@ static void xcb_source_finalize(GSource *source)
 {
     XCBSource *xcb_source = (XCBSource *)source;
 
-    // free queue
-    g_queue_free_full(xcb_source->events, free);
+    // free remaining events
+    for (; xcb_source->events_length > 0; xcb_source->events_length--)
+    {
+        free(xcb_source->events[xcb_source->events_head]);
+        xcb_source->events_head = (xcb_source->events_head + 1) % XCB_SOURCE_BATCH_SIZE;
+    }
+}
+
+// fill the event ring from xcb, optionally reading the socket once first.
+// events that do not fit stay queued in xcb and are taken on the next prepare
+static void xcb_source_read_events(XCBSource *xcb_source, gboolean read_socket)
+{
+    while (xcb_source->events_length < XCB_SOURCE_BATCH_SIZE)
+    {
+        // read the socket only for the first event, the rest are already queued
+        xcb_generic_event_t *event = (read_socket) ? xcb_poll_for_event(xcb_source->connection)
+                                                   : xcb_poll_for_queued_event(xcb_source->connection);
+        read_socket = FALSE;
+        if (!event)
+            break;
+
+        // push the event
+        guint tail = (xcb_source->events_head + xcb_source->events_length) % XCB_SOURCE_BATCH_SIZE;
+        xcb_source->events[tail] = event;
+        xcb_source->events_length++;
+    }
 }
@@ -19,8 +19,48 @@
 
 #include "state.h"
 
+#include <string.h>
+#include <xcb/xkb.h>
+
 #include "utils.h"
 
+// state shared by all the state instances, kept up to date from events so
+// reading it costs no round trips. the pointer position is only queried again
+// once it has moved
+typedef struct Tracker
+{
+    gint references;
+
+    BackendXCB *backend;
+    xcb_connection_t *connection;
+    xcb_window_t root_window;
+    xcb_input_device_id_t keyboard_id;
+    xcb_input_device_id_t pointer_id;
+
+    BackendStateEvent current;
+    gint pointer_changed;
+    xcb_input_get_device_modifier_mapping_reply_t *modifier_mapping;
+
+    GMutex mutex;
+    guint8 keys[32];
+} Tracker;
+
+// raw events tracked on the input thread
+#define TRACKER_RAW_EVENT_MASK (XCB_INPUT_XI_EVENT_MASK_RAW_KEY_PRESS |   \
+                                XCB_INPUT_XI_EVENT_MASK_RAW_KEY_RELEASE | \
+                                XCB_INPUT_XI_EVENT_MASK_RAW_MOTION)
+
+// xkb events tracked on the main thread
+#define TRACKER_XKB_EVENT_MASK ((1 << XCB_XKB_STATE_NOTIFY) | (1 << XCB_XKB_MAP_NOTIFY))
+
+static Tracker *tracker = NULL;
+
+static void tracker_ref(BackendXCB *backend);
+static void tracker_unref();
+static void tracker_query_pointer();
+static void callback_xkb(xcb_generic_event_t *event, gpointer null_ptr);
+static gboolean callback_raw(xcb_generic_event_t *event, gpointer null_ptr);
+
 // create a new state
 BackendXCBState *backend_xcb_state_new(BackendXCB *backend)
 {
@@ -36,6 +76,9 @@ BackendXCBState *backend_xcb_state_new(BackendXCB *backend)
     // get the master pointer
     state->pointer_id = backend_xcb_device_id_from_device_type(state->connection, XCB_INPUT_DEVICE_TYPE_MASTER_POINTER);
 
+    // start tracking
+    tracker_ref(backend);
+
     // return
     return state;
 }
@@ -43,21 +86,148 @@ BackendXCBState *backend_xcb_state_new(BackendXCB *backend)
 // destroy the state
 void backend_xcb_state_destroy(BackendXCBState *state)
 {
+    // stop tracking
+    tracker_unref();
+
     // free
     g_free(state);
 }
 
-// get state
+// get state, only querying the pointer if it has moved
 BackendStateEvent backend_xcb_state_current(BackendXCBState *state)
+{
+    if (g_atomic_int_compare_and_exchange(&tracker->pointer_changed, TRUE, FALSE))
+        tracker_query_pointer();
+    return tracker->current;
+}
+
+// get the keycodes currently held down, as a bit per keycode
+void backend_xcb_state_keys(BackendXCBState *state, guint8 keys[32])
+{
+    g_mutex_lock(&tracker->mutex);
+    memcpy(keys, tracker->keys, sizeof(tracker->keys));
+    g_mutex_unlock(&tracker->mutex);
+}
+
+// get the keycodes of each modifier, owned by the state until the mapping changes
+xcb_input_get_device_modifier_mapping_reply_t *backend_xcb_state_modifier_mapping(BackendXCBState *state)
+{
+    // return the cached mapping
+    if (tracker->modifier_mapping)
+        return tracker->modifier_mapping;
+
+    // send get modifiers mapping request
+    xcb_input_get_device_modifier_mapping_cookie_t cookie;
+    cookie = xcb_input_get_device_modifier_mapping(tracker->connection, tracker->keyboard_id);
+
+    // get the reply
+    xcb_generic_error_t *error = NULL;
+    tracker->modifier_mapping = xcb_input_get_device_modifier_mapping_reply(tracker->connection, cookie, &error);
+    if (error)
+    {
+        g_warning("backend-xcb: Failed to get modifier mapping: error: %d", error->error_code);
+        free(error);
+    }
+
+    // return
+    return tracker->modifier_mapping;
+}
+
+// mark the pointer as moved by something without raw events, such as a warp
+void backend_xcb_state_pointer_moved(BackendXCBState *state)
+{
+    g_atomic_int_set(&tracker->pointer_changed, TRUE);
+}
+
+// parse state from modifiers and group
+BackendStateEvent backend_xcb_state_parse(BackendXCBState *state,
+                                          xcb_input_modifier_info_t mods, xcb_input_group_info_t group,
+                                          xcb_input_fp1616_t pointer_x, xcb_input_fp1616_t pointer_y)
+{
+    // xcb has a bug where the effective modifiers are not computed sometimes (e.g. in the query pointer response)
+    BackendStateEvent event = {
+        .modifiers = mods.base | mods.latched | mods.locked | mods.effective,
+        .group = group.base | group.latched | group.locked | group.effective,
+        .pointer_x = pointer_x >> 16,
+        .pointer_y = pointer_y >> 16,
+    };
+    return event;
+}
+
+// add a reference to the tracker, creating it for the first state
+static void tracker_ref(BackendXCB *backend)
+{
+    if (tracker)
+    {
+        tracker->references++;
+        return;
+    }
+
+    tracker = g_new(Tracker, 1);
+    tracker->references = 1;
+
+    // add backend
+    tracker->backend = backend;
+    tracker->connection = backend_xcb_get_connection(backend);
+    tracker->root_window = backend_xcb_get_root_window(backend);
+
+    // get device ids
+    tracker->keyboard_id = backend_xcb_device_id_from_device_type(tracker->connection, XCB_INPUT_DEVICE_TYPE_MASTER_KEYBOARD);
+    tracker->pointer_id = backend_xcb_device_id_from_device_type(tracker->connection, XCB_INPUT_DEVICE_TYPE_MASTER_POINTER);
+
+    // init the cache
+    tracker->modifier_mapping = NULL;
+    g_mutex_init(&tracker->mutex);
+
+    // listen before querying so no change is missed
+    backend_xcb_subscribe(backend, BACKEND_XCB_EXTENSION_XKB, TRACKER_XKB_EVENT_MASK, callback_xkb, NULL);
+    backend_xcb_input_subscribe(backend_xcb_get_input(backend), TRACKER_RAW_EVENT_MASK, callback_raw, NULL);
+
+    // get the initial pressed keys
+    xcb_query_keymap_reply_t *keymap_reply = xcb_query_keymap_reply(tracker->connection, xcb_query_keymap(tracker->connection), NULL);
+    g_mutex_lock(&tracker->mutex);
+    if (keymap_reply)
+        memcpy(tracker->keys, keymap_reply->keys, sizeof(tracker->keys));
+    else
+        memset(tracker->keys, 0, sizeof(tracker->keys));
+    g_mutex_unlock(&tracker->mutex);
+    free(keymap_reply);
+
+    // get the initial state
+    tracker->pointer_changed = FALSE;
+    tracker_query_pointer();
+}
+
+// remove a reference to the tracker, freeing it with the last state
+static void tracker_unref()
+{
+    if (--tracker->references > 0)
+        return;
+
+    // stop listening, the input thread is not running the callback after this
+    backend_xcb_unsubscribe(tracker->backend, BACKEND_XCB_EXTENSION_XKB, TRACKER_XKB_EVENT_MASK, callback_xkb, NULL);
+    backend_xcb_input_unsubscribe(backend_xcb_get_input(tracker->backend), TRACKER_RAW_EVENT_MASK, callback_raw, NULL);
+
+    // free the cache
+    free(tracker->modifier_mapping);
+    g_mutex_clear(&tracker->mutex);
+
+    // free
+    g_free(tracker);
+    tracker = NULL;
+}
+
+// query the state from the pointer
+static void tracker_query_pointer()
 {
     // send request
     xcb_input_xi_query_pointer_cookie_t cookie;
-    cookie = xcb_input_xi_query_pointer(state->connection, state->root_window, state->pointer_id);
+    cookie = xcb_input_xi_query_pointer(tracker->connection, tracker->root_window, tracker->pointer_id);
 
     // get response
     xcb_generic_error_t *error = NULL;
     xcb_input_xi_query_pointer_reply_t *reply;
-    reply = xcb_input_xi_query_pointer_reply(state->connection, cookie, &error);
+    reply = xcb_input_xi_query_pointer_reply(tracker->connection, cookie, &error);
     if (error != NULL)
     {
         g_warning("backend-xcb: Failed to query pointer: error: %d", error->error_code);
@@ -65,32 +235,62 @@ BackendStateEvent backend_xcb_state_current(BackendXCBState *state)
     }
     if (!reply)
     {
-        BackendStateEvent event = {
+        tracker->current = (BackendStateEvent){
             .modifiers = 0,
             .group = 0,
             .pointer_x = 0,
             .pointer_y = 0,
         };
-        return event;
+        return;
     }
 
-    // get state
-    BackendStateEvent event = backend_xcb_state_parse(state, reply->mods, reply->group, reply->root_x, reply->root_y);
+    // set state
+    tracker->current = backend_xcb_state_parse(NULL, reply->mods, reply->group, reply->root_x, reply->root_y);
     free(reply);
-    return event;
 }
 
-// parse state from modifiers and group
-BackendStateEvent backend_xcb_state_parse(BackendXCBState *state,
-                                          xcb_input_modifier_info_t mods, xcb_input_group_info_t group,
-                                          xcb_input_fp1616_t pointer_x, xcb_input_fp1616_t pointer_y)
+// callback for xkb state and mapping changes
+static void callback_xkb(xcb_generic_event_t *event, gpointer null_ptr)
 {
-    // xcb has a bug where the effective modifiers are not computed sometimes (e.g. in the query pointer response)
-    BackendStateEvent event = {
-        .modifiers = mods.base | mods.latched | mods.locked | mods.effective,
-        .group = group.base | group.latched | group.locked | group.effective,
-        .pointer_x = pointer_x >> 16,
-        .pointer_y = pointer_y >> 16,
-    };
-    return event;
+    // all xkb events share the header holding the xkb type
+    xcb_xkb_state_notify_event_t *state_event = (xcb_xkb_state_notify_event_t *)event;
+
+    // drop the modifier mapping, fetched again when next used
+    if (state_event->xkbType == XCB_XKB_MAP_NOTIFY)
+    {
+        free(tracker->modifier_mapping);
+        tracker->modifier_mapping = NULL;
+        return;
+    }
+
+    // set the modifiers and group the same way as parsing them
+    tracker->current.modifiers = state_event->baseMods | state_event->latchedMods | state_event->lockedMods | state_event->mods;
+    tracker->current.group = state_event->baseGroup | state_event->latchedGroup | state_event->lockedGroup | state_event->group;
+}
+
+// callback for raw input events, run on the input thread
+static gboolean callback_raw(xcb_generic_event_t *event, gpointer null_ptr)
+{
+    xcb_input_raw_key_press_event_t *raw_event = (xcb_input_raw_key_press_event_t *)event;
+    guint8 keycode = raw_event->detail;
+
+    switch (raw_event->event_type)
+    {
+    case XCB_INPUT_RAW_KEY_PRESS:
+        g_mutex_lock(&tracker->mutex);
+        tracker->keys[keycode / 8] |= 1 << (keycode % 8);
+        g_mutex_unlock(&tracker->mutex);
+        break;
+    case XCB_INPUT_RAW_KEY_RELEASE:
+        g_mutex_lock(&tracker->mutex);
+        tracker->keys[keycode / 8] &= ~(1 << (keycode % 8));
+        g_mutex_unlock(&tracker->mutex);
+        break;
+    case XCB_INPUT_RAW_MOTION:
+        g_atomic_int_set(&tracker->pointer_changed, TRUE);
+        break;
+    }
+
+    // the main thread doesn't need raw events
+    return FALSE;
 }
@@ -24,7 +24,8 @@
 #include "../state.h"
 #include "focus.h"
 
-// backend for getting and parsing keyboard state
+// backend for getting and parsing keyboard state. the state is cached and kept
+// up to date from events, shared by all the instances
 typedef struct BackendXCBState
 {
     BackendXCB *backend;
@@ -38,6 +39,9 @@ typedef struct BackendXCBState
 BackendXCBState *backend_xcb_state_new(BackendXCB *backend);
 void backend_xcb_state_destroy(BackendXCBState *state);
 BackendStateEvent backend_xcb_state_current(BackendXCBState *state);
+void backend_xcb_state_keys(BackendXCBState *state, guint8 keys[32]);
+xcb_input_get_device_modifier_mapping_reply_t *backend_xcb_state_modifier_mapping(BackendXCBState *state);
+void backend_xcb_state_pointer_moved(BackendXCBState *state);
 
 BackendStateEvent backend_xcb_state_parse(BackendXCBState *state,
                                           xcb_input_modifier_info_t mods, xcb_input_group_info_t group,
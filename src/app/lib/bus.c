@@ -0,0 +1,795 @@
+/**
+ * Copyright (C) 2021 Ryan Britton
+ *
+ * This file is part of Goodnight Mouse.
+ *
+ * Goodnight Mouse is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Goodnight Mouse is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Goodnight Mouse.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bus.h"
+
+// accessibility bus launcher, found in at-spi-bus-launcher.c
+#define BUS_LAUNCHER_NAME "org.a11y.Bus"
+#define BUS_LAUNCHER_PATH "/org/a11y/bus"
+#define BUS_LAUNCHER_INTERFACE "org.a11y.Bus"
+#define BUS_ADDRESS_ENVAR "AT_SPI_BUS_ADDRESS"
+
+// longest call deadline, the default method call timeout found in atspi-misc.c
+#define BUS_CALL_TIMEOUT 800
+// shortest call deadline, used for applications that recently timed out
+#define BUS_CALL_TIMEOUT_MIN 100
+// deadline as a multiple of the smoothed latency of an application
+#define BUS_CALL_TIMEOUT_FACTOR 8
+// consecutive timeouts before an application is skipped
+#define BUS_BREAKER_FAILURES 3
+// time an application is skipped for, in microseconds
+#define BUS_BREAKER_COOLDOWN (5 * G_USEC_PER_SEC)
+
+// state of a direct connection being opened
+typedef struct BusConnect
+{
+    GCancellable *cancellable;
+    GDBusConnection *connection;
+    gboolean timed_out;
+    gboolean done;
+} BusConnect;
+
+static GDBusConnection *bus_connect_broker();
+static gboolean bus_connect_peer(Bus *bus, const gchar *bus_name, gint timeout, GCancellable *cancellable,
+                                 GDBusConnection **connection, gboolean *timed_out);
+static GDBusConnection *bus_connect_address(const gchar *address, gint timeout, GCancellable *cancellable,
+                                            gboolean *timed_out);
+static void bus_connect_cancel(GCancellable *cancellable, gpointer connect_cancellable_ptr);
+static gboolean bus_connect_timeout(gpointer connect_ptr);
+static void bus_connect_callback(GObject *source, GAsyncResult *result, gpointer connect_ptr);
+static GDBusConnection *bus_get_connection(Bus *bus, const gchar *bus_name, gint *timeout, GCancellable *cancellable);
+static void bus_drop_connection(Bus *bus, const gchar *bus_name, GDBusConnection *connection);
+static void bus_record_call(Bus *bus, const gchar *bus_name, gint64 elapsed, gboolean timed_out);
+static void bus_peer_free(gpointer peer_ptr);
+static GVariant *bus_call_object(Bus *bus, BusObject *object, const gchar *interface, const gchar *method,
+                                 GVariant *parameters, const gchar *reply_type, GCancellable *cancellable);
+static GPtrArray *bus_read_objects(GVariant *reply);
+static void bus_do_action_callback(GObject *connection_ptr, GAsyncResult *result, gpointer task_ptr);
+
+// create a new bus, connecting to the broker
+Bus *bus_new()
+{
+    Bus *bus = g_new(Bus, 1);
+
+    // init members
+    g_mutex_init(&bus->mutex);
+    bus->broker = bus_connect_broker();
+    bus->peers = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, bus_peer_free);
+
+    return bus;
+}
+
+// destroy a bus, closing all direct connections
+void bus_destroy(Bus *bus)
+{
+    // free members
+    g_hash_table_unref(bus->peers);
+    if (bus->broker)
+        g_object_unref(bus->broker);
+    g_mutex_clear(&bus->mutex);
+
+    g_free(bus);
+}
+
+// call a method on an object of an application, using a direct connection if
+// the application supports it. returns NULL on error, timeout or cancellation
+GVariant *bus_call(Bus *bus, const gchar *bus_name, const gchar *path,
+                   const gchar *interface, const gchar *method,
+                   GVariant *parameters, const GVariantType *reply_type,
+                   GCancellable *cancellable)
+{
+    // keep the parameters for a retry
+    if (parameters)
+        g_variant_ref_sink(parameters);
+
+    // get the connection and deadline, none if the application is skipped
+    gint timeout;
+    GDBusConnection *connection = bus_get_connection(bus, bus_name, &timeout, cancellable);
+    if (!connection)
+    {
+        if (parameters)
+            g_variant_unref(parameters);
+        return NULL;
+    }
+
+    // direct connections have no destination
+    gboolean is_peer = connection != bus->broker;
+
+    // call the method
+    GError *error = NULL;
+    gint64 start = g_get_monotonic_time();
+    GVariant *reply = g_dbus_connection_call_sync(connection, is_peer ? NULL : bus_name,
+                                                  path, interface, method, parameters,
+                                                  reply_type, G_DBUS_CALL_FLAGS_NONE,
+                                                  timeout, cancellable, &error);
+
+    // fall back to the broker if the direct connection was lost
+    if (!reply && is_peer && !g_cancellable_is_cancelled(cancellable) && g_dbus_connection_is_closed(connection))
+    {
+        bus_drop_connection(bus, bus_name, connection);
+        g_clear_error(&error);
+        start = g_get_monotonic_time();
+        reply = g_dbus_connection_call_sync(bus->broker, bus_name,
+                                            path, interface, method, parameters,
+                                            reply_type, G_DBUS_CALL_FLAGS_NONE,
+                                            timeout, cancellable, &error);
+    }
+
+    // track the health of the application, cancelled calls say nothing about it
+    if (!g_cancellable_is_cancelled(cancellable))
+        bus_record_call(bus, bus_name, g_get_monotonic_time() - start,
+                        error && g_error_matches(error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT));
+
+    // log failures
+    if (error)
+    {
+        g_debug("bus: Call to '%s.%s' failed: %s", interface, method, error->message);
+        g_error_free(error);
+    }
+
+    // free
+    g_object_unref(connection);
+    if (parameters)
+        g_variant_unref(parameters);
+
+    return reply;
+}
+
+// get the role of an object
+gboolean bus_get_role(Bus *bus, BusObject *object, AtspiRole *role, GCancellable *cancellable)
+{
+    GVariant *reply = bus_call_object(bus, object, ATSPI_DBUS_INTERFACE_ACCESSIBLE, "GetRole", NULL, "(u)", cancellable);
+    if (!reply)
+        return FALSE;
+
+    guint32 value;
+    g_variant_get(reply, "(u)", &value);
+    g_variant_unref(reply);
+    *role = value;
+    return TRUE;
+}
+
+// get the name of an object, free with g_free
+gboolean bus_get_name(Bus *bus, BusObject *object, gchar **name, GCancellable *cancellable)
+{
+    GVariant *reply = bus_call_object(bus, object, "org.freedesktop.DBus.Properties", "Get",
+                                      g_variant_new("(ss)", ATSPI_DBUS_INTERFACE_ACCESSIBLE, "Name"), "(v)", cancellable);
+    if (!reply)
+        return FALSE;
+
+    GVariant *value;
+    g_variant_get(reply, "(v)", &value);
+    gboolean is_string = g_variant_is_of_type(value, G_VARIANT_TYPE_STRING);
+    if (is_string)
+        *name = g_variant_dup_string(value, NULL);
+    g_variant_unref(value);
+    g_variant_unref(reply);
+    return is_string;
+}
+
+// get the states of an object as a mask of BUS_STATE bits
+gboolean bus_get_states(Bus *bus, BusObject *object, guint64 *states, GCancellable *cancellable)
+{
+    GVariant *reply = bus_call_object(bus, object, ATSPI_DBUS_INTERFACE_ACCESSIBLE, "GetState", NULL, "(au)", cancellable);
+    if (!reply)
+        return FALSE;
+
+    // the states are split into 32 bit words, lowest first
+    *states = 0;
+    GVariantIter *iter;
+    guint32 word;
+    g_variant_get(reply, "(au)", &iter);
+    for (gint index = 0; index < 2 && g_variant_iter_next(iter, "u", &word); index++)
+        *states |= (guint64)word << (index * 32);
+    g_variant_iter_free(iter);
+    g_variant_unref(reply);
+    return TRUE;
+}
+
+// get the screen extents of an object
+gboolean bus_get_extents(Bus *bus, BusObject *object, AtspiRect *extents, GCancellable *cancellable)
+{
+    GVariant *reply = bus_call_object(bus, object, ATSPI_DBUS_INTERFACE_COMPONENT, "GetExtents",
+                                      g_variant_new("(u)", ATSPI_COORD_TYPE_SCREEN), "((iiii))", cancellable);
+    if (!reply)
+        return FALSE;
+
+    g_variant_get(reply, "((iiii))", &extents->x, &extents->y, &extents->width, &extents->height);
+    g_variant_unref(reply);
+    return TRUE;
+}
+
+// get the child of an object at a point on the screen, NULL if none or on error
+BusObject *bus_get_accessible_at_point(Bus *bus, BusObject *object, gint x, gint y, GCancellable *cancellable)
+{
+    GVariant *reply = bus_call_object(bus, object, ATSPI_DBUS_INTERFACE_COMPONENT, "GetAccessibleAtPoint",
+                                      g_variant_new("(iiu)", x, y, ATSPI_COORD_TYPE_SCREEN), "((so))", cancellable);
+    if (!reply)
+        return NULL;
+
+    // decode the reference
+    const gchar *bus_name, *path;
+    g_variant_get(reply, "((&s&o))", &bus_name, &path);
+    BusObject *child = g_str_equal(path, ATSPI_DBUS_PATH_NULL) ? NULL : bus_object_new(bus_name, path);
+    g_variant_unref(reply);
+
+    return child;
+}
+
+// get whether an object implements an interface
+gboolean bus_has_interface(Bus *bus, BusObject *object, const gchar *interface, GCancellable *cancellable)
+{
+    GVariant *reply = bus_call_object(bus, object, ATSPI_DBUS_INTERFACE_ACCESSIBLE, "GetInterfaces", NULL, "(as)", cancellable);
+    if (!reply)
+        return FALSE;
+
+    // look for the interface
+    gboolean has_interface = FALSE;
+    GVariantIter *iter;
+    const gchar *name;
+    g_variant_get(reply, "(as)", &iter);
+    while (!has_interface && g_variant_iter_next(iter, "&s", &name))
+        has_interface = g_str_equal(name, interface);
+    g_variant_iter_free(iter);
+    g_variant_unref(reply);
+    return has_interface;
+}
+
+// get the children of an object, empty on error
+GPtrArray *bus_get_children(Bus *bus, BusObject *object, GCancellable *cancellable)
+{
+    GVariant *reply = bus_call_object(bus, object, ATSPI_DBUS_INTERFACE_ACCESSIBLE, "GetChildren", NULL, "(a(so))", cancellable);
+    return bus_read_objects(reply);
+}
+
+// get up to count descendants of a collection matching a rule in canonical
+// order, starting after the last match if given. empty on error
+GPtrArray *bus_get_matches(Bus *bus, BusObject *object, GVariant *rule, BusObject *last, gint count, GCancellable *cancellable)
+{
+    GVariant *reply;
+    if (!last)
+        reply = bus_call_object(bus, object, ATSPI_DBUS_INTERFACE_COLLECTION, "GetMatches",
+                                g_variant_new("(@(aiia{ss}iaiiasib)uib)", rule,
+                                              ATSPI_Collection_SORT_ORDER_CANONICAL, count, FALSE),
+                                "(a(so))", cancellable);
+    else
+        reply = bus_call_object(bus, object, ATSPI_DBUS_INTERFACE_COLLECTION, "GetMatchesFrom",
+                                g_variant_new("(o@(aiia{ss}iaiiasib)uuib)", last->path, rule,
+                                              ATSPI_Collection_SORT_ORDER_CANONICAL, ATSPI_Collection_TREE_INORDER,
+                                              count, FALSE),
+                                "(a(so))", cancellable);
+    return bus_read_objects(reply);
+}
+
+// get the number of actions of an object, -1 on error
+gint bus_get_n_actions(Bus *bus, BusObject *object, GCancellable *cancellable)
+{
+    GVariant *reply = bus_call_object(bus, object, "org.freedesktop.DBus.Properties", "Get",
+                                      g_variant_new("(ss)", ATSPI_DBUS_INTERFACE_ACTION, "NActions"), "(v)", cancellable);
+    if (!reply)
+        return -1;
+
+    GVariant *value;
+    g_variant_get(reply, "(v)", &value);
+    gint n_actions = g_variant_is_of_type(value, G_VARIANT_TYPE_INT32) ? g_variant_get_int32(value) : -1;
+    g_variant_unref(value);
+    g_variant_unref(reply);
+    return n_actions;
+}
+
+// do an action of an object
+gboolean bus_do_action(Bus *bus, BusObject *object, gint index, GCancellable *cancellable)
+{
+    GVariant *reply = bus_call_object(bus, object, ATSPI_DBUS_INTERFACE_ACTION, "DoAction",
+                                      g_variant_new("(i)", index), "(b)", cancellable);
+    if (!reply)
+        return FALSE;
+
+    gboolean success;
+    g_variant_get(reply, "(b)", &success);
+    g_variant_unref(reply);
+    return success;
+}
+
+// do an action of an object without waiting on the reply, which some toolkits
+// only send once the action's handler returns. the reply time says nothing about
+// the application's health, so it is not tracked. finish with bus_do_action_finish
+void bus_do_action_async(Bus *bus, BusObject *object, gint index, gint timeout, GCancellable *cancellable,
+                         GAsyncReadyCallback callback, gpointer data)
+{
+    GTask *task = g_task_new(NULL, cancellable, callback, data);
+
+    // get the connection, none if the application is skipped
+    gint deadline;
+    GDBusConnection *connection = bus_get_connection(bus, object->bus_name, &deadline, cancellable);
+    if (!connection)
+    {
+        g_task_return_new_error(task, G_IO_ERROR, G_IO_ERROR_NOT_CONNECTED,
+                                "Application '%s' is skipped", object->bus_name);
+        g_object_unref(task);
+        return;
+    }
+
+    // direct connections have no destination
+    gboolean is_peer = connection != bus->broker;
+
+    // call the method
+    g_dbus_connection_call(connection, is_peer ? NULL : object->bus_name, object->path,
+                           ATSPI_DBUS_INTERFACE_ACTION, "DoAction", g_variant_new("(i)", index),
+                           G_VARIANT_TYPE("(b)"), G_DBUS_CALL_FLAGS_NONE,
+                           timeout, cancellable, bus_do_action_callback, task);
+    g_object_unref(connection);
+}
+
+// get whether an action done with bus_do_action_async succeeded
+gboolean bus_do_action_finish(GAsyncResult *result, GError **error)
+{
+    return g_task_propagate_boolean(G_TASK(result), error);
+}
+
+// grab the input focus onto an object
+gboolean bus_grab_focus(Bus *bus, BusObject *object, GCancellable *cancellable)
+{
+    GVariant *reply = bus_call_object(bus, object, ATSPI_DBUS_INTERFACE_COMPONENT, "GrabFocus", NULL, "(b)", cancellable);
+    if (!reply)
+        return FALSE;
+
+    gboolean success;
+    g_variant_get(reply, "(b)", &success);
+    g_variant_unref(reply);
+    return success;
+}
+
+// create a collection match rule on states and roles, in the format sent by
+// atspi-matchrule.c
+GVariant *bus_match_rule_new(guint64 states, AtspiCollectionMatchType state_match_type,
+                             GArray *roles, AtspiCollectionMatchType role_match_type)
+{
+    // states are split into 32 bit words
+    GVariantBuilder state_builder;
+    g_variant_builder_init(&state_builder, G_VARIANT_TYPE("ai"));
+    g_variant_builder_add(&state_builder, "i", (gint32)(states & 0xffffffff));
+    g_variant_builder_add(&state_builder, "i", (gint32)(states >> 32));
+
+    // roles are a 128 bit set
+    guint32 role_words[4] = {0, 0, 0, 0};
+    for (gint index = 0; roles && index < roles->len; index++)
+    {
+        AtspiRole role = g_array_index(roles, AtspiRole, index);
+        if (role < 128)
+            role_words[role / 32] |= 1u << (role % 32);
+    }
+    GVariantBuilder role_builder;
+    g_variant_builder_init(&role_builder, G_VARIANT_TYPE("ai"));
+    for (gint index = 0; index < 4; index++)
+        g_variant_builder_add(&role_builder, "i", (gint32)role_words[index]);
+
+    // no attributes or interfaces
+    return g_variant_ref_sink(g_variant_new("(aiia{ss}iaiiasib)",
+                                            &state_builder, state_match_type,
+                                            NULL, ATSPI_Collection_MATCH_NONE,
+                                            &role_builder, role_match_type,
+                                            NULL, ATSPI_Collection_MATCH_NONE,
+                                            FALSE));
+}
+
+// create a new object reference
+BusObject *bus_object_new(const gchar *bus_name, const gchar *path)
+{
+    BusObject *object = g_new(BusObject, 1);
+    object->bus_name = g_strdup(bus_name);
+    object->path = g_strdup(path);
+    return object;
+}
+
+// create a new object reference to the same object as a libatspi accessible
+BusObject *bus_object_new_for_accessible(AtspiAccessible *accessible)
+{
+    AtspiObject *atspi_object = ATSPI_OBJECT(accessible);
+    if (!atspi_object->app || !atspi_object->app->bus_name || !atspi_object->path)
+        return NULL;
+
+    return bus_object_new(atspi_object->app->bus_name, atspi_object->path);
+}
+
+// copy an object reference
+BusObject *bus_object_copy(BusObject *object)
+{
+    return bus_object_new(object->bus_name, object->path);
+}
+
+// free an object reference
+void bus_object_free(gpointer object_ptr)
+{
+    BusObject *object = object_ptr;
+    g_free(object->bus_name);
+    g_free(object->path);
+    g_free(object);
+}
+
+// hash an object reference, for use in hash tables
+guint bus_object_hash(gconstpointer object_ptr)
+{
+    const BusObject *object = object_ptr;
+    return g_str_hash(object->bus_name) * 31 + g_str_hash(object->path);
+}
+
+// check if two object references are to the same object
+gboolean bus_object_equal(gconstpointer object_ptr, gconstpointer other_object_ptr)
+{
+    const BusObject *object = object_ptr;
+    const BusObject *other_object = other_object_ptr;
+    return g_str_equal(object->path, other_object->path) &&
+           g_str_equal(object->bus_name, other_object->bus_name);
+}
+
+// connect to the accessibility bus broker
+static GDBusConnection *bus_connect_broker()
+{
+    GError *error = NULL;
+
+    // get the address from the environment or the launcher
+    gchar *address = g_strdup(g_getenv(BUS_ADDRESS_ENVAR));
+    if (!address)
+    {
+        GDBusConnection *session = g_bus_get_sync(G_BUS_TYPE_SESSION, NULL, &error);
+        if (!session)
+        {
+            g_warning("bus: Could not connect to the session bus: %s", error->message);
+            g_error_free(error);
+            return NULL;
+        }
+
+        GVariant *reply = g_dbus_connection_call_sync(session, BUS_LAUNCHER_NAME, BUS_LAUNCHER_PATH,
+                                                      BUS_LAUNCHER_INTERFACE, "GetAddress", NULL,
+                                                      G_VARIANT_TYPE("(s)"), G_DBUS_CALL_FLAGS_NONE,
+                                                      -1, NULL, &error);
+        g_object_unref(session);
+        if (!reply)
+        {
+            g_warning("bus: Could not get the accessibility bus address: %s", error->message);
+            g_error_free(error);
+            return NULL;
+        }
+
+        g_variant_get(reply, "(s)", &address);
+        g_variant_unref(reply);
+    }
+
+    // connect to the broker
+    GDBusConnection *broker = g_dbus_connection_new_for_address_sync(address,
+                                                                     G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+                                                                         G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+                                                                     NULL, NULL, &error);
+    g_free(address);
+    if (!broker)
+    {
+        g_warning("bus: Could not connect to the accessibility bus: %s", error->message);
+        g_error_free(error);
+        return NULL;
+    }
+
+    return broker;
+}
+
+// open a direct connection to an application within the deadline. returns whether
+// the application answered, with the connection set to NULL if it does not
+// support one. timed_out is set if it did not answer in time
+static gboolean bus_connect_peer(Bus *bus, const gchar *bus_name, gint timeout, GCancellable *cancellable,
+                                 GDBusConnection **connection, gboolean *timed_out)
+{
+    *connection = NULL;
+    *timed_out = FALSE;
+
+    // ask the application for its private bus address
+    GError *error = NULL;
+    gint64 start = g_get_monotonic_time();
+    GVariant *reply = g_dbus_connection_call_sync(bus->broker, bus_name, ATSPI_DBUS_PATH_ROOT,
+                                                  ATSPI_DBUS_INTERFACE_APPLICATION, "GetApplicationBusAddress", NULL,
+                                                  G_VARIANT_TYPE("(s)"), G_DBUS_CALL_FLAGS_NONE,
+                                                  timeout, cancellable, &error);
+    if (!reply)
+    {
+        // applications without the method answered, they use the broker
+        gboolean answered = g_error_matches(error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD);
+        *timed_out = g_error_matches(error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT);
+        g_error_free(error);
+        return answered;
+    }
+
+    // the address is empty if not supported
+    const gchar *address;
+    g_variant_get(reply, "(&s)", &address);
+    if (address[0] == '\0')
+    {
+        g_variant_unref(reply);
+        return TRUE;
+    }
+
+    // connect within the rest of the deadline, the broker is used if it fails otherwise
+    gint remaining = MAX(timeout - (gint)((g_get_monotonic_time() - start) / 1000), 1);
+    *connection = bus_connect_address(address, remaining, cancellable, timed_out);
+    g_variant_unref(reply);
+
+    return !*timed_out;
+}
+
+// connect to a private bus address, giving up once cancelled or after the
+// deadline. the handshake needs the application's main loop, so it would block
+// forever on a hung application otherwise
+static GDBusConnection *bus_connect_address(const gchar *address, gint timeout, GCancellable *cancellable,
+                                            gboolean *timed_out)
+{
+    GCancellable *connect_cancellable = g_cancellable_new();
+    BusConnect connect = {connect_cancellable, NULL, FALSE, FALSE};
+
+    // run the connection in a context of its own, so only it is dispatched
+    GMainContext *context = g_main_context_new();
+    g_main_context_push_thread_default(context);
+
+    // abort on the deadline or once the caller is cancelled
+    gulong handler_id = cancellable ? g_cancellable_connect(cancellable, G_CALLBACK(bus_connect_cancel),
+                                                            connect_cancellable, NULL)
+                                    : 0;
+    GSource *source = g_timeout_source_new(timeout);
+    g_source_set_callback(source, bus_connect_timeout, &connect, NULL);
+    g_source_attach(source, context);
+
+    // connect and wait
+    g_dbus_connection_new_for_address(address, G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT,
+                                      NULL, connect_cancellable, bus_connect_callback, &connect);
+    while (!connect.done)
+        g_main_context_iteration(context, TRUE);
+
+    // free
+    g_source_destroy(source);
+    g_source_unref(source);
+    if (cancellable)
+        g_cancellable_disconnect(cancellable, handler_id);
+    g_object_unref(connect_cancellable);
+    g_main_context_pop_thread_default(context);
+    g_main_context_unref(context);
+
+    *timed_out = connect.timed_out;
+    return connect.connection;
+}
+
+// cancels a connection when its caller is cancelled, may run on any thread
+static void bus_connect_cancel(GCancellable *cancellable, gpointer connect_cancellable_ptr)
+{
+    g_cancellable_cancel(connect_cancellable_ptr);
+}
+
+// cancels a connection that did not complete in time
+static gboolean bus_connect_timeout(gpointer connect_ptr)
+{
+    BusConnect *connect = connect_ptr;
+    connect->timed_out = TRUE;
+    g_cancellable_cancel(connect->cancellable);
+    return G_SOURCE_REMOVE;
+}
+
+// completes a connection
+static void bus_connect_callback(GObject *source, GAsyncResult *result, gpointer connect_ptr)
+{
+    BusConnect *connect = connect_ptr;
+    connect->connection = g_dbus_connection_new_for_address_finish(result, NULL);
+    connect->done = TRUE;
+}
+
+// get a reference to the connection used to reach an application and the
+// deadline to call it with, or NULL if the application is being skipped or did
+// not answer. the direct connection is looked up on first contact, and again
+// on later calls until the application answers
+static GDBusConnection *bus_get_connection(Bus *bus, const gchar *bus_name, gint *timeout, GCancellable *cancellable)
+{
+    // no connection without the broker
+    if (!bus->broker)
+        return NULL;
+
+    g_mutex_lock(&bus->mutex);
+
+    // add the peer on first contact, using the broker until resolved
+    BusPeer *peer = g_hash_table_lookup(bus->peers, bus_name);
+    if (!peer)
+    {
+        peer = g_new(BusPeer, 1);
+        peer->connection = g_object_ref(bus->broker);
+        peer->is_resolved = FALSE;
+        peer->latency = 0;
+        peer->failures = 0;
+        peer->skip_until = 0;
+        g_hash_table_insert(bus->peers, g_strdup(bus_name), peer);
+    }
+
+    // skip while the breaker is open
+    if (g_get_monotonic_time() < peer->skip_until)
+    {
+        g_mutex_unlock(&bus->mutex);
+        return NULL;
+    }
+
+    // afterwards allow calls on a tight deadline
+    if (peer->failures > 0)
+        *timeout = BUS_CALL_TIMEOUT_MIN;
+    else if (peer->latency == 0)
+        *timeout = BUS_CALL_TIMEOUT;
+    else
+        *timeout = CLAMP(peer->latency * BUS_CALL_TIMEOUT_FACTOR / 1000, BUS_CALL_TIMEOUT_MIN, BUS_CALL_TIMEOUT);
+
+    // use the resolved connection
+    GDBusConnection *connection = g_object_ref(peer->connection);
+    gboolean is_resolved = peer->is_resolved;
+    g_mutex_unlock(&bus->mutex);
+    if (is_resolved)
+        return connection;
+
+    // resolve the connection, without holding the lock over the calls
+    GDBusConnection *direct;
+    gboolean timed_out;
+    gint64 start = g_get_monotonic_time();
+    gboolean answered = bus_connect_peer(bus, bus_name, *timeout, cancellable, &direct, &timed_out);
+
+    // give up if cancelled, it says nothing about the application
+    if (g_cancellable_is_cancelled(cancellable))
+    {
+        if (direct)
+            g_object_unref(direct);
+        g_object_unref(connection);
+        return NULL;
+    }
+
+    // count a timeout towards the breaker and fail the call, the application is not answering
+    if (timed_out)
+    {
+        bus_record_call(bus, bus_name, g_get_monotonic_time() - start, TRUE);
+        g_object_unref(connection);
+        return NULL;
+    }
+
+    // use the broker for this call if the lookup failed otherwise, it is tried again next time
+    if (!answered)
+        return connection;
+
+    // cache the answer, unless another thread got there first
+    g_object_unref(connection);
+    g_mutex_lock(&bus->mutex);
+    if (!peer->is_resolved)
+    {
+        if (direct)
+        {
+            g_object_unref(peer->connection);
+            peer->connection = g_object_ref(direct);
+        }
+        peer->is_resolved = TRUE;
+    }
+    connection = g_object_ref(peer->connection);
+    g_mutex_unlock(&bus->mutex);
+    if (direct)
+        g_object_unref(direct);
+
+    return connection;
+}
+
+// remove a lost direct connection from the cache, the broker is used instead
+static void bus_drop_connection(Bus *bus, const gchar *bus_name, GDBusConnection *connection)
+{
+    g_mutex_lock(&bus->mutex);
+    BusPeer *peer = g_hash_table_lookup(bus->peers, bus_name);
+    if (peer && peer->connection == connection)
+    {
+        g_object_unref(peer->connection);
+        peer->connection = g_object_ref(bus->broker);
+    }
+    g_mutex_unlock(&bus->mutex);
+}
+
+// record the result of a call to an application, opening the breaker if it
+// keeps timing out
+static void bus_record_call(Bus *bus, const gchar *bus_name, gint64 elapsed, gboolean timed_out)
+{
+    g_mutex_lock(&bus->mutex);
+
+    BusPeer *peer = g_hash_table_lookup(bus->peers, bus_name);
+    if (peer)
+    {
+        if (timed_out)
+        {
+            // skip the application after too many timeouts in a row
+            peer->failures++;
+            if (peer->failures >= BUS_BREAKER_FAILURES)
+            {
+                g_debug("bus: Application '%s' keeps timing out, skipping it", bus_name);
+                peer->skip_until = g_get_monotonic_time() + BUS_BREAKER_COOLDOWN;
+
+                // a single timeout after the cooldown skips it again
+                peer->failures = BUS_BREAKER_FAILURES - 1;
+            }
+        }
+        else
+        {
+            // smooth the latency
+            peer->failures = 0;
+            peer->latency = peer->latency == 0 ? elapsed : (peer->latency * 7 + elapsed) / 8;
+        }
+    }
+
+    g_mutex_unlock(&bus->mutex);
+}
+
+// free a peer
+static void bus_peer_free(gpointer peer_ptr)
+{
+    BusPeer *peer = peer_ptr;
+    g_object_unref(peer->connection);
+    g_free(peer);
+}
+
+// completes the task of an action from its reply
+static void bus_do_action_callback(GObject *connection_ptr, GAsyncResult *result, gpointer task_ptr)
+{
+    GTask *task = task_ptr;
+
+    // get the reply
+    GError *error = NULL;
+    GVariant *reply = g_dbus_connection_call_finish(G_DBUS_CONNECTION(connection_ptr), result, &error);
+    if (!reply)
+    {
+        g_task_return_error(task, error);
+        g_object_unref(task);
+        return;
+    }
+
+    // return the success
+    gboolean success;
+    g_variant_get(reply, "(b)", &success);
+    g_variant_unref(reply);
+    g_task_return_boolean(task, success);
+    g_object_unref(task);
+}
+
+// call a method on an object
+static GVariant *bus_call_object(Bus *bus, BusObject *object, const gchar *interface, const gchar *method,
+                                 GVariant *parameters, const gchar *reply_type, GCancellable *cancellable)
+{
+    return bus_call(bus, object->bus_name, object->path, interface, method,
+                    parameters, G_VARIANT_TYPE(reply_type), cancellable);
+}
+
+// read a list of object references from a reply, skipping null references
+static GPtrArray *bus_read_objects(GVariant *reply)
+{
+    GPtrArray *objects = g_ptr_array_new_with_free_func(bus_object_free);
+    if (!reply)
+        return objects;
+
+    // decode the references
+    GVariantIter *iter;
+    const gchar *bus_name, *path;
+    g_variant_get(reply, "(a(so))", &iter);
+    while (g_variant_iter_next(iter, "(&s&o)", &bus_name, &path))
+    {
+        if (!g_str_equal(path, ATSPI_DBUS_PATH_NULL))
+            g_ptr_array_add(objects, bus_object_new(bus_name, path));
+    }
+    g_variant_iter_free(iter);
+    g_variant_unref(reply);
+
+    return objects;
+}
@@ -0,0 +1,91 @@
+/**
+ * Copyright (C) 2021 Ryan Britton
+ *
+ * This file is part of Goodnight Mouse.
+ *
+ * Goodnight Mouse is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Goodnight Mouse is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Goodnight Mouse.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef B09DA08F_A8F5_459C_9ED1_1A4B1653A320
+#define B09DA08F_A8F5_459C_9ED1_1A4B1653A320
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <atspi/atspi.h>
+
+// reference to an accessible on an application's bus, decoded from replies
+// without creating a libatspi proxy
+typedef struct BusObject
+{
+    gchar *bus_name;
+    gchar *path;
+} BusObject;
+
+// bit of a state in a state mask
+#define BUS_STATE(state) ((guint64)1 << (state))
+
+// connection and call health of an application
+typedef struct BusPeer
+{
+    GDBusConnection *connection;
+    gboolean is_resolved;
+    gint64 latency;
+    guint failures;
+    gint64 skip_until;
+} BusPeer;
+
+// cache of direct connections to the private bus of each accessible
+// application, falling back to the accessibility bus broker. tracks the latency
+// of each application to set its call deadlines, and stops calling applications
+// that keep timing out for a while. safe to use from any thread
+typedef struct Bus
+{
+    GMutex mutex;
+    GDBusConnection *broker;
+    GHashTable *peers;
+} Bus;
+
+Bus *bus_new();
+void bus_destroy(Bus *bus);
+GVariant *bus_call(Bus *bus, const gchar *bus_name, const gchar *path,
+                   const gchar *interface, const gchar *method,
+                   GVariant *parameters, const GVariantType *reply_type,
+                   GCancellable *cancellable);
+
+gboolean bus_get_name(Bus *bus, BusObject *object, gchar **name, GCancellable *cancellable);
+gboolean bus_get_role(Bus *bus, BusObject *object, AtspiRole *role, GCancellable *cancellable);
+gboolean bus_get_states(Bus *bus, BusObject *object, guint64 *states, GCancellable *cancellable);
+gboolean bus_get_extents(Bus *bus, BusObject *object, AtspiRect *extents, GCancellable *cancellable);
+BusObject *bus_get_accessible_at_point(Bus *bus, BusObject *object, gint x, gint y, GCancellable *cancellable);
+gboolean bus_has_interface(Bus *bus, BusObject *object, const gchar *interface, GCancellable *cancellable);
+GPtrArray *bus_get_children(Bus *bus, BusObject *object, GCancellable *cancellable);
+GPtrArray *bus_get_matches(Bus *bus, BusObject *object, GVariant *rule, BusObject *last, gint count, GCancellable *cancellable);
+gint bus_get_n_actions(Bus *bus, BusObject *object, GCancellable *cancellable);
+gboolean bus_do_action(Bus *bus, BusObject *object, gint index, GCancellable *cancellable);
+void bus_do_action_async(Bus *bus, BusObject *object, gint index, gint timeout, GCancellable *cancellable,
+                         GAsyncReadyCallback callback, gpointer data);
+gboolean bus_do_action_finish(GAsyncResult *result, GError **error);
+gboolean bus_grab_focus(Bus *bus, BusObject *object, GCancellable *cancellable);
+
+GVariant *bus_match_rule_new(guint64 states, AtspiCollectionMatchType state_match_type,
+                             GArray *roles, AtspiCollectionMatchType role_match_type);
+
+BusObject *bus_object_new(const gchar *bus_name, const gchar *path);
+BusObject *bus_object_new_for_accessible(AtspiAccessible *accessible);
+BusObject *bus_object_copy(BusObject *object);
+void bus_object_free(gpointer object_ptr);
+guint bus_object_hash(gconstpointer object_ptr);
+gboolean bus_object_equal(gconstpointer object_ptr, gconstpointer other_object_ptr);
+
+#endif /* B09DA08F_A8F5_459C_9ED1_1A4B1653A320 */
@@ -85,24 +85,21 @@ gboolean emulator_key(Emulator *emulator, guint keysym, GdkModifierType modifier
     BackendKeyboardEvent event = *((BackendKeyboardEvent *)recipes->data);
     g_list_free_full(recipes, g_free);
 
-    // send a key press
-    event.pressed = TRUE;
-    if (!backend_emulator_key(emulator->backend, event))
-    {
-        emulator_reset(emulator);
+    // submit the whole press and release as one sequence
+    if (!backend_emulator_begin(emulator->backend))
         return FALSE;
-    }
 
-    // send key release
+    // send a key press and release
+    event.pressed = TRUE;
+    gboolean is_success = backend_emulator_key(emulator->backend, event);
     event.pressed = FALSE;
-    if (!backend_emulator_key(emulator->backend, event))
-    {
-        emulator_reset(emulator);
-        return FALSE;
-    }
+    is_success = is_success && backend_emulator_key(emulator->backend, event);
 
     // reset the state
-    return emulator_reset(emulator);
+    is_success = emulator_reset(emulator) && is_success;
+
+    // submit the sequence
+    return backend_emulator_commit(emulator->backend) && is_success;
 }
 
 gboolean emulator_move(Emulator *emulator, gint x, gint y)
@@ -114,12 +111,16 @@ gboolean emulator_move(Emulator *emulator, gint x, gint y)
     state.pointer_x = x;
     state.pointer_y = y;
 
-    // set the state
-    if (!backend_emulator_state(emulator->backend, state))
+    // submit the move and reset as one sequence
+    if (!backend_emulator_begin(emulator->backend))
         return FALSE;
 
-    // reset the state
-    return emulator_reset(emulator);
+    // set the state, then reset it
+    gboolean is_success = backend_emulator_state(emulator->backend, state);
+    is_success = emulator_reset(emulator) && is_success;
+
+    // submit the sequence
+    return backend_emulator_commit(emulator->backend) && is_success;
 }
 
 gboolean emulator_button(Emulator *emulator, guint button, GdkModifierType modifiers, gint x, gint y)
@@ -142,22 +143,21 @@ gboolean emulator_button(Emulator *emulator, guint button, GdkModifierType modif
         .state = pressed_state,
     };
 
-    // send a button press
-    event.pressed = TRUE;
-    if (!backend_emulator_button(emulator->backend, event))
-    {
-        emulator_reset(emulator);
+    // submit the modifiers, warp, press, release and restore as one sequence
+    if (!backend_emulator_begin(emulator->backend))
         return FALSE;
-    }
 
-    // send a button release
+    // send a button press and release
+    event.pressed = TRUE;
+    gboolean is_success = backend_emulator_button(emulator->backend, event);
     event.pressed = FALSE;
-    if (!backend_emulator_button(emulator->backend, event))
-    {
-        emulator_reset(emulator);
-        return FALSE;
-    }
+    is_success = is_success && backend_emulator_button(emulator->backend, event);
+
+    // restore the previous state without querying it again, then reset
+    if (is_success)
+        is_success = backend_emulator_state(emulator->backend, previous_state);
+    is_success = emulator_reset(emulator) && is_success;
 
-    // move the pointer back
-    return emulator_move(emulator, previous_state.pointer_x, previous_state.pointer_y);
+    // submit the sequence
+    return backend_emulator_commit(emulator->backend) && is_success;
 }
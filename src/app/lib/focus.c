@@ -36,11 +36,11 @@ Focus *focus_new(Backend *backend)
     // init subscribers
     focus->subscribers = NULL;
 
-    // add backend
+    // add backend and set the current window
+    worker_lock();
     focus->backend = backend_focus_new(backend, callback_focus, focus);
-
-    // set the current window
     focus->accessible = backend_focus_get_window(focus->backend);
+    worker_unlock();
 
     return focus;
 }
@@ -49,14 +49,18 @@ Focus *focus_new(Backend *backend)
 void focus_destroy(Focus *focus)
 {
     // free backend
+    worker_lock();
     backend_focus_destroy(focus->backend);
+    worker_unlock();
 
     // free subscribers
     g_list_free_full(focus->subscribers, g_free);
 
-    // unref window
+    // unref window, the atspi cache is shared with the worker
+    worker_lock();
     if (focus->accessible)
         g_object_unref(focus->accessible);
+    worker_unlock();
 
     g_free(focus);
 }
@@ -106,12 +110,15 @@ static void callback_focus(gpointer focus_ptr)
 {
     Focus *focus = focus_ptr;
 
-    // get the current window
+    // get the current window, references are dropped with the lock held as the
+    // atspi cache is shared with the worker
+    worker_lock();
     AtspiAccessible *accessible = backend_focus_get_window(focus->backend);
     if (accessible == focus->accessible)
     {
         if (accessible)
             g_object_unref(accessible);
+        worker_unlock();
         return;
     }
 
@@ -119,6 +126,7 @@ static void callback_focus(gpointer focus_ptr)
     if (focus->accessible)
         g_object_unref(focus->accessible);
     focus->accessible = accessible;
+    worker_unlock();
 
     // notify the subscribers
     for (GList *link = focus->subscribers; link; link = link->next)
@@ -24,6 +24,7 @@
 #include <atspi/atspi.h>
 
 #include "backend/backend.h"
+#include "worker.h"
 
 // a callback for when the currently focused window changes, possibly to NULL
 typedef void (*FocusCallback)(AtspiAccessible *window, gpointer data);
@@ -19,6 +19,9 @@
 
 #include "keyboard.h"
 
+// key of the subscribers for a keysym and modifiers
+#define SUBSCRIBERS_KEY(keysym, modifiers) (((gint64)(keysym) << 8) | (modifiers))
+
 // subscriber of keyboard events
 typedef struct Subscriber
 {
@@ -30,21 +33,43 @@ typedef struct Subscriber
     GList *grabs;
 } Subscriber;
 
-static BackendKeyboardEventResponse callback_keyboard(BackendKeyboardEvent backend_event, gpointer keyboard_ptr);
+// key passed through to the focused window while the keyboard is grabbed
+typedef struct Relay
+{
+    guint keysym;
+    guint8 modifiers;
+    GList *recipes;
+} Relay;
+
+static void relay_recipes(Keyboard *keyboard, Relay *relay);
+static void unrelay_recipes(Keyboard *keyboard, Relay *relay);
+static void callback_keyboard(BackendKeyboardEvent backend_event, gpointer keyboard_ptr);
+static void callback_keys_changed(GdkKeymap *gdk_keymap, gpointer keyboard_ptr);
+static void set_key_subscribers(Keyboard *keyboard, gint64 key, GList *subscribers);
+static void free_subscribers(gpointer subscribers_ptr);
 
 // creates a new keyboard event keyboard and starts listening
 Keyboard *keyboard_new(Backend *backend, Keymap *keymap)
 {
     Keyboard *keyboard = g_new(Keyboard, 1);
 
-    // add backend
+    // add backend, the legacy backend registers atspi listeners
+    worker_lock();
     keyboard->backend = backend_keyboard_new(backend, callback_keyboard, keyboard);
+    worker_unlock();
 
     // add keymap
     keyboard->keymap = keymap;
 
-    // init subscribers
+    // init subscribers, key subscribers are indexed by keysym and modifiers
     keyboard->subscribers = NULL;
+    keyboard->key_subscribers = g_hash_table_new_full(g_int64_hash, g_int64_equal, g_free, free_subscribers);
+    keyboard->suspended = 0;
+
+    // init relays, their keycodes are found again when the keyboard layout changes
+    keyboard->relays = NULL;
+    keyboard->keys_changed_id = g_signal_connect(keymap->keymap, "keys-changed",
+                                                 G_CALLBACK(callback_keys_changed), keyboard);
 
     return keyboard;
 }
@@ -53,10 +78,19 @@ Keyboard *keyboard_new(Backend *backend, Keymap *keymap)
 void keyboard_destroy(Keyboard *keyboard)
 {
     // free backend
+    worker_lock();
     backend_keyboard_destroy(keyboard->backend);
+    worker_unlock();
 
     // free subscribers
     g_list_free_full(keyboard->subscribers, g_free);
+    g_hash_table_unref(keyboard->key_subscribers);
+
+    // free relays
+    g_signal_handler_disconnect(keyboard->keymap->keymap, keyboard->keys_changed_id);
+    for (GList *link = keyboard->relays; link; link = link->next)
+        g_list_free_full(((Relay *)link->data)->recipes, g_free);
+    g_list_free_full(keyboard->relays, g_free);
 
     // free
     g_free(keyboard);
@@ -74,8 +108,9 @@ void keyboard_subscribe(Keyboard *keyboard, KeyboardCallback callback, gpointer
     // add subscriber
     keyboard->subscribers = g_list_append(keyboard->subscribers, subscriber);
 
-    // grab the keyboard
-    backend_keyboard_grab(keyboard->backend);
+    // grab the keyboard, unless suspended
+    if (!keyboard->suspended)
+        backend_keyboard_grab(keyboard->backend);
 }
 
 // remove keyboard event subscription
@@ -92,8 +127,9 @@ void keyboard_unsubscribe(Keyboard *keyboard, KeyboardCallback callback, gpointe
               (subscriber->all_keys == TRUE)))
             continue;
 
-        // ungrab the keyboard
-        backend_keyboard_ungrab(keyboard->backend);
+        // ungrab the keyboard, unless suspended
+        if (!keyboard->suspended)
+            backend_keyboard_ungrab(keyboard->backend);
 
         // remove subscriber
         keyboard->subscribers = g_list_delete_link(keyboard->subscribers, link);
@@ -130,7 +166,9 @@ void keyboard_subscribe_key(Keyboard *keyboard, guint keysym, GdkModifierType mo
         g_warning("keyboard: No valid keys to grab: keysym: %d, modifiers: 0x%X", keysym, modifiers);
 
     // add subscriber
-    keyboard->subscribers = g_list_append(keyboard->subscribers, subscriber);
+    gint64 key = SUBSCRIBERS_KEY(keysym, modifiers);
+    GList *subscribers = g_hash_table_lookup(keyboard->key_subscribers, &key);
+    set_key_subscribers(keyboard, key, g_list_append(subscribers, subscriber));
 }
 
 // removes a key subscription
@@ -139,17 +177,18 @@ void keyboard_unsubscribe_key(Keyboard *keyboard, guint keysym, GdkModifierType
     // sanitize modifiers
     modifiers = keymap_physical_modifiers(keyboard->keymap, modifiers);
 
+    // get the subscribers of the key
+    gint64 key = SUBSCRIBERS_KEY(keysym, modifiers);
+    GList *subscribers = g_hash_table_lookup(keyboard->key_subscribers, &key);
+
     // remove the first matching subscriber
-    for (GList *link = keyboard->subscribers; link; link = link->next)
+    for (GList *link = subscribers; link; link = link->next)
     {
         Subscriber *subscriber = link->data;
 
         // check if subscriber matches
         if (!((subscriber->callback == callback) &&
-              (subscriber->data == data) &&
-              (subscriber->all_keys == FALSE) &&
-              (subscriber->keysym == keysym) &&
-              (subscriber->modifiers == modifiers)))
+              (subscriber->data == data)))
             continue;
 
         // ungrab the keys
@@ -161,15 +200,110 @@ void keyboard_unsubscribe_key(Keyboard *keyboard, guint keysym, GdkModifierType
         g_list_free_full(subscriber->grabs, g_free);
 
         // remove subscriber
-        keyboard->subscribers = g_list_delete_link(keyboard->subscribers, link);
+        subscribers = g_list_delete_link(subscribers, link);
         g_free(subscriber);
 
+        // update the subscribers of the key
+        set_key_subscribers(keyboard, key, subscribers);
+
         return;
     }
 }
 
+// release the keyboard grabbed by subscribers of all keys, so emulated keys reach
+// the focused window. they are not notified until resumed
+void keyboard_suspend(Keyboard *keyboard)
+{
+    if (keyboard->suspended++ > 0)
+        return;
+
+    // ungrab for each subscriber
+    for (GList *link = keyboard->subscribers; link; link = link->next)
+        backend_keyboard_ungrab(keyboard->backend);
+}
+
+// grab the keyboard again for the subscribers of all keys after a suspend
+void keyboard_resume(Keyboard *keyboard)
+{
+    if (keyboard->suspended == 0 || --keyboard->suspended > 0)
+        return;
+
+    // grab for each subscriber
+    for (GList *link = keyboard->subscribers; link; link = link->next)
+        backend_keyboard_grab(keyboard->backend);
+}
+
+// let a key pass through to the focused window while the keyboard is grabbed.
+// the decision is made by the backend when the event arrives, before any callback runs
+void keyboard_relay_key(Keyboard *keyboard, guint keysym, GdkModifierType modifiers)
+{
+    // sanitize modifiers
+    modifiers = keymap_physical_modifiers(keyboard->keymap, modifiers);
+
+    // create a new relay
+    Relay *relay = g_new(Relay, 1);
+    relay->keysym = keysym;
+    relay->modifiers = modifiers;
+    relay->recipes = NULL;
+
+    // add the key relays
+    relay_recipes(keyboard, relay);
+
+    // add relay
+    keyboard->relays = g_list_append(keyboard->relays, relay);
+}
+
+// stop letting a key pass through while the keyboard is grabbed
+void keyboard_unrelay_key(Keyboard *keyboard, guint keysym, GdkModifierType modifiers)
+{
+    // sanitize modifiers
+    modifiers = keymap_physical_modifiers(keyboard->keymap, modifiers);
+
+    // remove the first matching relay
+    for (GList *link = keyboard->relays; link; link = link->next)
+    {
+        Relay *relay = link->data;
+
+        // check if relay matches
+        if (!((relay->keysym == keysym) &&
+              (relay->modifiers == modifiers)))
+            continue;
+
+        // remove the key relays
+        unrelay_recipes(keyboard, relay);
+
+        // remove relay
+        keyboard->relays = g_list_delete_link(keyboard->relays, link);
+        g_free(relay);
+        return;
+    }
+}
+
+// find the keycodes of a relay in the current layout and let them pass through
+static void relay_recipes(Keyboard *keyboard, Relay *relay)
+{
+    relay->recipes = keymap_get_keycodes(keyboard->keymap, relay->keysym, relay->modifiers);
+    for (GList *link = relay->recipes; link; link = link->next)
+    {
+        BackendKeyboardEvent *recipe = link->data;
+        backend_keyboard_relay_key(keyboard->backend, recipe->keycode, recipe->state);
+    }
+}
+
+// stop letting the keycodes of a relay pass through and forget them
+static void unrelay_recipes(Keyboard *keyboard, Relay *relay)
+{
+    for (GList *link = relay->recipes; link; link = link->next)
+    {
+        BackendKeyboardEvent *recipe = link->data;
+        backend_keyboard_unrelay_key(keyboard->backend, recipe->keycode, recipe->state);
+    }
+    g_list_free_full(relay->recipes, g_free);
+    relay->recipes = NULL;
+}
+
 // callback to handle an atspi keyboard event
-static BackendKeyboardEventResponse callback_keyboard(BackendKeyboardEvent backend_event, gpointer keyboard_ptr)
+static void callback_keyboard(BackendKeyboardEvent backend_event, gpointer keyboard_ptr)
 {
     Keyboard *keyboard = keyboard_ptr;
 
@@ -184,23 +318,56 @@ static BackendKeyboardEventResponse callback_keyboard(BackendKeyboardEvent backe
     guint8 relevant_modifiers = backend_event.state.modifiers & ~consumed_modifiers;
     guint8 hotkey_modifiers = keymap_hotkey_modifiers(keyboard->keymap, relevant_modifiers);
 
-    // notify subscribers
-    BackendKeyboardEventResponse response = BACKEND_KEYBOARD_EVENT_RELAY;
-    for (GList *link = keyboard->subscribers; link; link = link->next)
+    // notify subscribers of all keys, unless suspended
+    for (GList *link = keyboard->subscribers; link && !keyboard->suspended; link = link->next)
     {
         Subscriber *subscriber = link->data;
+        subscriber->callback(event, subscriber->data);
+    }
 
-        // check if event matches against subscription
-        if (!((subscriber->all_keys) ||
-              ((subscriber->keysym == event.keysym) &&
-               (subscriber->modifiers == hotkey_modifiers))))
-            continue;
+    // notify subscribers of this key
+    gint64 key = SUBSCRIBERS_KEY(event.keysym, hotkey_modifiers);
+    GList *subscribers = g_hash_table_lookup(keyboard->key_subscribers, &key);
+    for (GList *link = subscribers; link; link = link->next)
+    {
+        Subscriber *subscriber = link->data;
+        subscriber->callback(event, subscriber->data);
+    }
+}
 
-        // notify subscriber
-        if (subscriber->callback(event, subscriber->data) == KEYBOARD_EVENT_CONSUME)
-            response = BACKEND_KEYBOARD_EVENT_CONSUME;
+// set the subscribers of a key, removing the key if there are none
+static void set_key_subscribers(Keyboard *keyboard, gint64 key, GList *subscribers)
+{
+    // take the existing key without freeing the old subscribers
+    gpointer key_ptr = NULL;
+    if (!g_hash_table_steal_extended(keyboard->key_subscribers, &key, &key_ptr, NULL))
+    {
+        key_ptr = g_new(gint64, 1);
+        *(gint64 *)key_ptr = key;
     }
 
-    // return response
-    return response;
+    // add the subscribers back
+    if (subscribers)
+        g_hash_table_insert(keyboard->key_subscribers, key_ptr, subscribers);
+    else
+        g_free(key_ptr);
+}
+
+// free a list of subscribers
+static void free_subscribers(gpointer subscribers_ptr)
+{
+    g_list_free_full(subscribers_ptr, g_free);
+}
+
+// callback to find the keycodes of the relays again when the keyboard layout changes
+static void callback_keys_changed(GdkKeymap *gdk_keymap, gpointer keyboard_ptr)
+{
+    Keyboard *keyboard = keyboard_ptr;
+
+    g_debug("keyboard: Keys changed, rebuilding relays");
+    for (GList *link = keyboard->relays; link; link = link->next)
+    {
+        unrelay_recipes(keyboard, link->data);
+        relay_recipes(keyboard, link->data);
+    }
 }
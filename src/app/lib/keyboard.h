@@ -22,13 +22,7 @@
 
 #include "backend/backend.h"
 #include "keymap.h"
-
-// how to respond to a key event
-typedef enum KeyboardEventResponse
-{
-    KEYBOARD_EVENT_RELAY,
-    KEYBOARD_EVENT_CONSUME,
-} KeyboardEventResponse;
+#include "worker.h"
 
 // event for when a key is pressed or released
 typedef struct KeyboardEvent
@@ -39,7 +33,7 @@ typedef struct KeyboardEvent
 } KeyboardEvent;
 
 // callback type used to notify on subscribed keyboard event
-typedef KeyboardEventResponse (*KeyboardCallback)(KeyboardEvent event, gpointer data);
+typedef void (*KeyboardCallback)(KeyboardEvent event, gpointer data);
 
 // used to subscribe to events emitted from a keyboard
 typedef struct Keyboard
@@ -49,6 +43,11 @@ typedef struct Keyboard
     Keymap *keymap;
 
     GList *subscribers;
+    GHashTable *key_subscribers;
+    guint suspended;
+
+    GList *relays;
+    gulong keys_changed_id;
 } Keyboard;
 
 Keyboard *keyboard_new(Backend *backend, Keymap *keymap);
@@ -57,5 +56,9 @@ void keyboard_subscribe(Keyboard *keyboard, KeyboardCallback callback, gpointer
 void keyboard_unsubscribe(Keyboard *keyboard, KeyboardCallback callback, gpointer data);
 void keyboard_subscribe_key(Keyboard *keyboard, guint keysym, GdkModifierType modifiers, KeyboardCallback callback, gpointer data);
 void keyboard_unsubscribe_key(Keyboard *keyboard, guint keysym, GdkModifierType modifiers, KeyboardCallback callback, gpointer data);
+void keyboard_suspend(Keyboard *keyboard);
+void keyboard_resume(Keyboard *keyboard);
+void keyboard_relay_key(Keyboard *keyboard, guint keysym, GdkModifierType modifiers);
+void keyboard_unrelay_key(Keyboard *keyboard, guint keysym, GdkModifierType modifiers);
 
 #endif /* D102CB85_DF5A_44CB_80DC_B281855A12AB */
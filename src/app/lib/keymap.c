@@ -21,6 +21,13 @@
 
 #define HOTKEY_MODIFIERS (GDK_SHIFT_MASK | GDK_CONTROL_MASK | GDK_MOD1_MASK | GDK_SUPER_MASK)
 
+#define NUM_ROWS (KEYMAP_KEYCODES * KEYMAP_GROUPS)
+
+static void keymap_rebuild(Keymap *keymap);
+static void keymap_clear_rows(Keymap *keymap);
+static guint keymap_translate(Keymap *keymap, guint keycode, guint8 modifiers, guint8 group, guint8 *consumed_modifiers);
+static void callback_keys_changed(GdkKeymap *gdk_keymap, gpointer keymap_ptr);
+
 // creates a new keymap translator
 Keymap *keymap_new()
 {
@@ -29,8 +36,16 @@ Keymap *keymap_new()
     // add keymap
     keymap->keymap = gdk_keymap_get_for_display(gdk_display_get_default());
 
-    // add valid modifiers
-    keymap->hotkey_modifiers = keymap_physical_modifiers(keymap, HOTKEY_MODIFIERS);
+    // init the decode table, a row per keycode and group is allocated on first lookup
+    for (gint row = 0; row < NUM_ROWS; row++)
+        keymap->rows[row] = NULL;
+
+    // build the cached modifiers
+    keymap_rebuild(keymap);
+
+    // rebuild when the keyboard layout changes
+    keymap->keys_changed_id = g_signal_connect(keymap->keymap, "keys-changed",
+                                               G_CALLBACK(callback_keys_changed), keymap);
 
     // return
     return keymap;
@@ -39,6 +54,12 @@ Keymap *keymap_new()
 // stops and destroys a keymap
 void keymap_destroy(Keymap *keymap)
 {
+    // stop listening for layout changes
+    g_signal_handler_disconnect(keymap->keymap, keymap->keys_changed_id);
+
+    // free decode table
+    keymap_clear_rows(keymap);
+
     // free
     g_free(keymap);
 }
@@ -53,9 +74,7 @@ guint8 keymap_physical_modifiers(Keymap *keymap, GdkModifierType modifiers)
 // map all modifiers, physical and virtual
 GdkModifierType keymap_all_modifiers(Keymap *keymap, guint8 physical_modifiers)
 {
-    GdkModifierType modifiers = physical_modifiers;
-    gdk_keymap_add_virtual_modifiers(keymap->keymap, &modifiers);
-    return modifiers;
+    return keymap->all_modifiers[physical_modifiers];
 }
 
 // return only the modifiers used in hotkeys
@@ -112,12 +131,68 @@ GList *keymap_get_keycodes(Keymap *keymap, guint keysym, guint8 additional_modif
 
 // lookup a keysym by key event. hotkey modifiers are modifiers relevant to hotkeys
 guint keymap_get_keysym(Keymap *keymap, BackendKeyboardEvent event, guint8 *consumed_modifiers)
+{
+    // translate directly if the event does not fit in the table
+    if (event.keycode >= KEYMAP_KEYCODES || event.state.group >= KEYMAP_GROUPS)
+        return keymap_translate(keymap, event.keycode, event.state.modifiers, event.state.group, consumed_modifiers);
+
+    // get the table row, allocating it on first lookup
+    KeymapEntry **row = &keymap->rows[event.keycode * KEYMAP_GROUPS + event.state.group];
+    if (!*row)
+        *row = g_new0(KeymapEntry, KEYMAP_MODIFIERS);
+
+    // get the table entry
+    KeymapEntry *entry = &(*row)[event.state.modifiers];
+
+    // fill the entry on first lookup
+    if (!entry->valid)
+    {
+        entry->keysym = keymap_translate(keymap, event.keycode, event.state.modifiers, event.state.group,
+                                         &entry->consumed_modifiers);
+        entry->valid = TRUE;
+    }
+
+    // return consumed modifiers
+    if (consumed_modifiers)
+        *consumed_modifiers = entry->consumed_modifiers;
+
+    // return
+    return entry->keysym;
+}
+
+// clears the decode table and recomputes the modifier mappings
+static void keymap_rebuild(Keymap *keymap)
+{
+    // invalidate all decoded keys
+    keymap_clear_rows(keymap);
+
+    // map every physical modifier state to all modifiers
+    for (gint physical_modifiers = 0; physical_modifiers < KEYMAP_MODIFIERS; physical_modifiers++)
+    {
+        GdkModifierType modifiers = physical_modifiers;
+        gdk_keymap_add_virtual_modifiers(keymap->keymap, &modifiers);
+        keymap->all_modifiers[physical_modifiers] = modifiers;
+    }
+
+    // add valid modifiers
+    keymap->hotkey_modifiers = keymap_physical_modifiers(keymap, HOTKEY_MODIFIERS);
+}
+
+// frees all the rows of the decode table
+static void keymap_clear_rows(Keymap *keymap)
+{
+    for (gint row = 0; row < NUM_ROWS; row++)
+        g_clear_pointer(&keymap->rows[row], g_free);
+}
+
+// translate a key event using gdk
+static guint keymap_translate(Keymap *keymap, guint keycode, guint8 modifiers, guint8 group, guint8 *consumed_modifiers)
 {
     // lookup keysym and consumed modifiers
-    guint keysym;
+    guint keysym = GDK_KEY_VoidSymbol;
     GdkModifierType returned_consumed_modifiers;
-    gdk_keymap_translate_keyboard_state(keymap->keymap, event.keycode,
-                                        event.state.modifiers, event.state.group,
+    gdk_keymap_translate_keyboard_state(keymap->keymap, keycode,
+                                        modifiers, group,
                                         &keysym, NULL, NULL, &returned_consumed_modifiers);
 
     // return consumed modifiers
@@ -127,3 +202,12 @@ guint keymap_get_keysym(Keymap *keymap, BackendKeyboardEvent event, guint8 *cons
     // return
     return keysym;
 }
+
+// callback to rebuild the tables when the keyboard layout changes
+static void callback_keys_changed(GdkKeymap *gdk_keymap, gpointer keymap_ptr)
+{
+    Keymap *keymap = keymap_ptr;
+
+    g_debug("keymap: Keys changed, rebuilding decode table");
+    keymap_rebuild(keymap);
+}
@@ -24,11 +24,28 @@
 
 #include "backend/backend.h"
 
+// size of the keysym decode table
+#define KEYMAP_KEYCODES (256)
+#define KEYMAP_GROUPS (4)
+#define KEYMAP_MODIFIERS (256)
+
+// cached translation of a keycode, group and modifiers state
+typedef struct KeymapEntry
+{
+    guint keysym;
+    guint8 consumed_modifiers;
+    gboolean valid;
+} KeymapEntry;
+
 // used to subscribe to events emitted from a keymap
 typedef struct Keymap
 {
     GdkKeymap *keymap;
     guint8 hotkey_modifiers;
+
+    KeymapEntry *rows[KEYMAP_KEYCODES * KEYMAP_GROUPS];
+    GdkModifierType all_modifiers[KEYMAP_MODIFIERS];
+    gulong keys_changed_id;
 } Keymap;
 
 Keymap *keymap_new();
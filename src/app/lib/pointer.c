@@ -19,6 +19,9 @@
 
 #include "pointer.h"
 
+// key of the subscribers for a button and modifiers
+#define SUBSCRIBERS_KEY(button, modifiers) (((gint64)(button) << 8) | (modifiers))
+
 // subscriber of pointer events
 typedef struct Subscriber
 {
@@ -29,21 +32,26 @@ typedef struct Subscriber
     guint8 modifiers;
 } Subscriber;
 
-static BackendPointerEventResponse callback_pointer(BackendPointerEvent backend_event, gpointer pointer_ptr);
+static void callback_pointer(BackendPointerEvent backend_event, gpointer pointer_ptr);
+static void set_button_subscribers(Pointer *pointer, gint64 key, GList *subscribers);
+static void free_subscribers(gpointer subscribers_ptr);
 
 // creates a new pointer and starts listening
 Pointer *pointer_new(Backend *backend, Keymap *keymap)
 {
     Pointer *pointer = g_new(Pointer, 1);
 
-    // add backend
+    // add backend, the legacy backend registers atspi listeners
+    worker_lock();
     pointer->backend = backend_pointer_new(backend, callback_pointer, pointer);
+    worker_unlock();
 
     // add keymap
     pointer->keymap = keymap;
 
-    // init subscribers
+    // init subscribers, button subscribers are indexed by button and modifiers
     pointer->subscribers = NULL;
+    pointer->button_subscribers = g_hash_table_new_full(g_int64_hash, g_int64_equal, g_free, free_subscribers);
 
     return pointer;
 }
@@ -52,10 +60,13 @@ Pointer *pointer_new(Backend *backend, Keymap *keymap)
 void pointer_destroy(Pointer *pointer)
 {
     // free backend
+    worker_lock();
     backend_pointer_destroy(pointer->backend);
+    worker_unlock();
 
     // free subscribers
     g_list_free_full(pointer->subscribers, g_free);
+    g_hash_table_unref(pointer->button_subscribers);
 
     // free
     g_free(pointer);
@@ -125,7 +136,9 @@ void pointer_subscribe_button(Pointer *pointer, guint button, GdkModifierType mo
     backend_pointer_grab_button(pointer->backend, subscriber->button, state);
 
     // add subscriber
-    pointer->subscribers = g_list_append(pointer->subscribers, subscriber);
+    gint64 key = SUBSCRIBERS_KEY(button, modifiers);
+    GList *subscribers = g_hash_table_lookup(pointer->button_subscribers, &key);
+    set_button_subscribers(pointer, key, g_list_append(subscribers, subscriber));
 }
 
 // removes a key subscription
@@ -134,17 +147,18 @@ void pointer_unsubscribe_button(Pointer *pointer, guint button, GdkModifierType
     // sanitize modifiers
     modifiers = keymap_physical_modifiers(pointer->keymap, modifiers);
 
+    // get the subscribers of the button
+    gint64 key = SUBSCRIBERS_KEY(button, modifiers);
+    GList *subscribers = g_hash_table_lookup(pointer->button_subscribers, &key);
+
     // remove the first matching subscriber
-    for (GList *link = pointer->subscribers; link; link = link->next)
+    for (GList *link = subscribers; link; link = link->next)
     {
         Subscriber *subscriber = link->data;
 
         // check if subscriber matches
         if (!((subscriber->callback == callback) &&
-              (subscriber->data == data) &&
-              (subscriber->all_buttons == FALSE) &&
-              (subscriber->button == button) &&
-              (subscriber->modifiers == modifiers)))
+              (subscriber->data == data)))
             continue;
 
         // ungrab the keys
@@ -156,14 +170,17 @@ void pointer_unsubscribe_button(Pointer *pointer, guint button, GdkModifierType
         backend_pointer_ungrab_button(pointer->backend, subscriber->button, state);
 
         // remove subscriber
-        pointer->subscribers = g_list_delete_link(pointer->subscribers, link);
+        subscribers = g_list_delete_link(subscribers, link);
         g_free(subscriber);
+
+        // update the subscribers of the button
+        set_button_subscribers(pointer, key, subscribers);
         return;
     }
 }
 
 // callback to handle an atspi pointer event
-static BackendPointerEventResponse callback_pointer(BackendPointerEvent backend_event, gpointer pointer_ptr)
+static void callback_pointer(BackendPointerEvent backend_event, gpointer pointer_ptr)
 {
     Pointer *pointer = pointer_ptr;
 
@@ -176,23 +193,43 @@ static BackendPointerEventResponse callback_pointer(BackendPointerEvent backend_
     // get only hotkey modifiers
     guint8 hotkey_modifiers = keymap_hotkey_modifiers(pointer->keymap, backend_event.state.modifiers);
 
-    // notify subscribers
-    BackendPointerEventResponse response = BACKEND_POINTER_EVENT_RELAY;
+    // notify subscribers of all buttons
     for (GList *link = pointer->subscribers; link; link = link->next)
     {
         Subscriber *subscriber = link->data;
+        subscriber->callback(event, subscriber->data);
+    }
 
-        // check if event matches against subscription
-        if (!((subscriber->all_buttons) ||
-              ((subscriber->button == event.button) &&
-               (subscriber->modifiers == hotkey_modifiers))))
-            continue;
+    // notify subscribers of this button
+    gint64 key = SUBSCRIBERS_KEY(event.button, hotkey_modifiers);
+    GList *subscribers = g_hash_table_lookup(pointer->button_subscribers, &key);
+    for (GList *link = subscribers; link; link = link->next)
+    {
+        Subscriber *subscriber = link->data;
+        subscriber->callback(event, subscriber->data);
+    }
+}
 
-        // notify subscriber
-        if (subscriber->callback(event, subscriber->data) == POINTER_EVENT_CONSUME)
-            response = BACKEND_POINTER_EVENT_CONSUME;
+// set the subscribers of a button, removing the button if there are none
+static void set_button_subscribers(Pointer *pointer, gint64 key, GList *subscribers)
+{
+    // take the existing key without freeing the old subscribers
+    gpointer key_ptr = NULL;
+    if (!g_hash_table_steal_extended(pointer->button_subscribers, &key, &key_ptr, NULL))
+    {
+        key_ptr = g_new(gint64, 1);
+        *(gint64 *)key_ptr = key;
     }
 
-    // return response
-    return response;
+    // add the subscribers back
+    if (subscribers)
+        g_hash_table_insert(pointer->button_subscribers, key_ptr, subscribers);
+    else
+        g_free(key_ptr);
+}
+
+// free a list of subscribers
+static void free_subscribers(gpointer subscribers_ptr)
+{
+    g_list_free_full(subscribers_ptr, g_free);
 }
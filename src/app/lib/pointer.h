@@ -22,13 +22,7 @@
 
 #include "backend/backend.h"
 #include "keymap.h"
-
-// how to respond to a pointer event
-typedef enum PointerEventResponse
-{
-    POINTER_EVENT_RELAY,
-    POINTER_EVENT_CONSUME,
-} PointerEventResponse;
+#include "worker.h"
 
 // event for when a button is pressed or released
 typedef struct PointerEvent
@@ -39,7 +33,7 @@ typedef struct PointerEvent
 } PointerEvent;
 
 // callback type used to notify for pointer events
-typedef PointerEventResponse (*PointerCallback)(PointerEvent event, gpointer data);
+typedef void (*PointerCallback)(PointerEvent event, gpointer data);
 
 // used to subscribe to events emitted from a pointer
 typedef struct Pointer
@@ -49,6 +43,7 @@ typedef struct Pointer
     Keymap *keymap;
 
     GList *subscribers;
+    GHashTable *button_subscribers;
 } Pointer;
 
 Pointer *pointer_new(Backend *backend, Keymap *keymap);
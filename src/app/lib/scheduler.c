@@ -0,0 +1,183 @@
+/**
+ * Copyright (C) 2021 Ryan Britton
+ *
+ * This file is part of Goodnight Mouse.
+ *
+ * Goodnight Mouse is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Goodnight Mouse is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Goodnight Mouse.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scheduler.h"
+
+// interval between frames in microseconds
+#define SCHEDULER_FRAME_INTERVAL (16667)
+
+// time each priority may run per frame in microseconds, the rest of the frame
+// is left to the other sources of the context
+static const gint64 SCHEDULER_BUDGETS[SCHEDULER_PRIORITY_COUNT] = {
+    [SCHEDULER_PRIORITY_RENDER] = 4000,
+    [SCHEDULER_PRIORITY_REPOSITION] = 2000,
+    [SCHEDULER_PRIORITY_CRAWL] = 12000,
+};
+
+static gboolean scheduler_dispatch(GSource *source, GSourceFunc callback, gpointer scheduler_ptr);
+static void scheduler_run_priority(Scheduler *scheduler, SchedulerPriority priority);
+static void scheduler_schedule(Scheduler *scheduler);
+static GList *scheduler_find(Scheduler *scheduler, guint task_id, SchedulerPriority *priority);
+
+static GSourceFuncs scheduler_source_funcs = {
+    .dispatch = scheduler_dispatch,
+};
+
+// create a new scheduler running on a context, the default context if NULL
+Scheduler *scheduler_new(GMainContext *context)
+{
+    Scheduler *scheduler = g_new(Scheduler, 1);
+
+    // init the tasks
+    for (gint priority = 0; priority < SCHEDULER_PRIORITY_COUNT; priority++)
+        scheduler->tasks[priority] = g_queue_new();
+    scheduler->next_id = 1;
+    scheduler->frame_start = 0;
+
+    // create the source, only ready while there are tasks
+    scheduler->source = g_source_new(&scheduler_source_funcs, sizeof(GSource));
+    g_source_set_priority(scheduler->source, G_PRIORITY_DEFAULT_IDLE);
+    g_source_set_callback(scheduler->source, NULL, scheduler, NULL);
+    g_source_set_ready_time(scheduler->source, -1);
+    g_source_attach(scheduler->source, context);
+
+    return scheduler;
+}
+
+// destroy a scheduler, dropping any remaining tasks
+void scheduler_destroy(Scheduler *scheduler)
+{
+    // free the source
+    g_source_destroy(scheduler->source);
+    g_source_unref(scheduler->source);
+
+    // free the tasks
+    for (gint priority = 0; priority < SCHEDULER_PRIORITY_COUNT; priority++)
+        g_queue_free_full(scheduler->tasks[priority], g_free);
+
+    g_free(scheduler);
+}
+
+// add a task, run a slice at a time until the function returns FALSE
+guint scheduler_add(Scheduler *scheduler, SchedulerPriority priority, SchedulerFunc func, gpointer data)
+{
+    SchedulerTask *task = g_new(SchedulerTask, 1);
+    task->id = scheduler->next_id++;
+    task->func = func;
+    task->data = data;
+    g_queue_push_tail(scheduler->tasks[priority], task);
+
+    // make sure a frame is coming
+    scheduler_schedule(scheduler);
+
+    return task->id;
+}
+
+// remove a task before it has finished, does nothing if it is not found
+void scheduler_remove(Scheduler *scheduler, guint task_id)
+{
+    SchedulerPriority priority;
+    GList *link = scheduler_find(scheduler, task_id, &priority);
+    if (!link)
+        return;
+
+    g_free(link->data);
+    g_queue_delete_link(scheduler->tasks[priority], link);
+}
+
+// run a frame of tasks
+static gboolean scheduler_dispatch(GSource *source, GSourceFunc callback, gpointer scheduler_ptr)
+{
+    Scheduler *scheduler = scheduler_ptr;
+
+    // start the frame
+    scheduler->frame_start = g_get_monotonic_time();
+    g_source_set_ready_time(scheduler->source, -1);
+
+    // run each priority within its budget
+    for (gint priority = 0; priority < SCHEDULER_PRIORITY_COUNT; priority++)
+        scheduler_run_priority(scheduler, priority);
+
+    // wait for the next frame if there is more to do
+    scheduler_schedule(scheduler);
+
+    return G_SOURCE_CONTINUE;
+}
+
+// run slices of the tasks of a priority in turn until done or out of budget
+static void scheduler_run_priority(Scheduler *scheduler, SchedulerPriority priority)
+{
+    GQueue *tasks = scheduler->tasks[priority];
+    gint64 deadline = g_get_monotonic_time() + SCHEDULER_BUDGETS[priority];
+
+    while (!g_queue_is_empty(tasks) && g_get_monotonic_time() < deadline)
+    {
+        // run a slice of the first task
+        SchedulerTask *task = g_queue_peek_head(tasks);
+        guint task_id = task->id;
+        gboolean more = task->func(task->data);
+
+        // the task may have been removed while running
+        SchedulerPriority found_priority;
+        GList *link = scheduler_find(scheduler, task_id, &found_priority);
+        if (!link)
+            continue;
+
+        // drop finished tasks, let the others of this priority take a turn
+        g_queue_unlink(scheduler->tasks[found_priority], link);
+        if (more)
+            g_queue_push_tail_link(scheduler->tasks[found_priority], link);
+        else
+        {
+            g_free(link->data);
+            g_list_free_1(link);
+        }
+    }
+}
+
+// set when the source is next ready, at the next frame if there are tasks
+static void scheduler_schedule(Scheduler *scheduler)
+{
+    // never ready without tasks
+    gboolean has_tasks = FALSE;
+    for (gint priority = 0; priority < SCHEDULER_PRIORITY_COUNT; priority++)
+        has_tasks |= !g_queue_is_empty(scheduler->tasks[priority]);
+    if (!has_tasks)
+    {
+        g_source_set_ready_time(scheduler->source, -1);
+        return;
+    }
+
+    // don't delay an earlier wakeup
+    gint64 ready_time = g_source_get_ready_time(scheduler->source);
+    gint64 next_frame = scheduler->frame_start + SCHEDULER_FRAME_INTERVAL;
+    if (ready_time != -1 && ready_time <= next_frame)
+        return;
+    g_source_set_ready_time(scheduler->source, next_frame);
+}
+
+// find the link of a task and its priority
+static GList *scheduler_find(Scheduler *scheduler, guint task_id, SchedulerPriority *priority)
+{
+    for (*priority = 0; *priority < SCHEDULER_PRIORITY_COUNT; (*priority)++)
+        for (GList *link = scheduler->tasks[*priority]->head; link; link = link->next)
+            if (((SchedulerTask *)link->data)->id == task_id)
+                return link;
+    return NULL;
+}
@@ -0,0 +1,63 @@
+/**
+ * Copyright (C) 2021 Ryan Britton
+ *
+ * This file is part of Goodnight Mouse.
+ *
+ * Goodnight Mouse is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Goodnight Mouse is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Goodnight Mouse.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef B423C24D_9500_40C1_A1B6_4A8AE7B2B5C5
+#define B423C24D_9500_40C1_A1B6_4A8AE7B2B5C5
+
+#include <glib.h>
+
+// priority of scheduled work, highest first
+typedef enum SchedulerPriority
+{
+    SCHEDULER_PRIORITY_RENDER,
+    SCHEDULER_PRIORITY_REPOSITION,
+    SCHEDULER_PRIORITY_CRAWL,
+    SCHEDULER_PRIORITY_COUNT,
+} SchedulerPriority;
+
+// runs a single slice of a task, returns whether the task has more work
+typedef gboolean (*SchedulerFunc)(gpointer data);
+
+// task run by a scheduler until it has no more work
+typedef struct SchedulerTask
+{
+    guint id;
+    SchedulerFunc func;
+    gpointer data;
+} SchedulerTask;
+
+// cooperative scheduler that runs task slices on a context once per frame,
+// highest priority first, until each priority has spent its frame budget.
+// it dispatches at idle priority so input and painting are served first.
+// a scheduler is only used from the thread running its context, or while
+// holding the lock of that thread as with the worker
+typedef struct Scheduler
+{
+    GSource *source;
+    GQueue *tasks[SCHEDULER_PRIORITY_COUNT];
+    guint next_id;
+    gint64 frame_start;
+} Scheduler;
+
+Scheduler *scheduler_new(GMainContext *context);
+void scheduler_destroy(Scheduler *scheduler);
+guint scheduler_add(Scheduler *scheduler, SchedulerPriority priority, SchedulerFunc func, gpointer data);
+void scheduler_remove(Scheduler *scheduler, guint task_id);
+
+#endif /* B423C24D_9500_40C1_A1B6_4A8AE7B2B5C5 */
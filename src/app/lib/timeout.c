@@ -21,6 +21,8 @@
 
 #include <atspi/atspi.h>
 
+#include "worker.h"
+
 // default timeouts, found in atspi-misc.c
 #define METHOD_CALL_TIMEOUT 800
 #define APP_STARTUP_TIME 15000
@@ -39,6 +41,7 @@ void timeout_enable()
     if (timeout_enabled)
         return;
     timeout_enabled = TRUE;
+    worker_lock();
 
     // set the default timeouts
     atspi_set_timeout(METHOD_CALL_TIMEOUT, APP_STARTUP_TIME);
@@ -52,6 +55,8 @@ void timeout_enable()
 
     // unhide log timeout warnings
     g_log_remove_handler("dbind", log_handler_id);
+
+    worker_unlock();
 }
 
 // disable the atspi dbus call timeouts
@@ -60,6 +65,7 @@ void timeout_disable()
     if (!timeout_enabled)
         return;
     timeout_enabled = FALSE;
+    worker_lock();
 
     // hide log timeout warnings
     log_handler_id = g_log_set_handler("dbind", G_LOG_LEVEL_WARNING, log_handler, NULL);
@@ -75,6 +81,8 @@ void timeout_disable()
 
     // unref the accessible
     g_object_unref(desktop);
+
+    worker_unlock();
 }
 
 // log handler to hide dbus timeout log warnings
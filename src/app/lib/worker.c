@@ -0,0 +1,165 @@
+/**
+ * Copyright (C) 2021 Ryan Britton
+ *
+ * This file is part of Goodnight Mouse.
+ *
+ * Goodnight Mouse is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Goodnight Mouse is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Goodnight Mouse.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "worker.h"
+
+#include <atspi/atspi.h>
+
+// initial number of file descriptors to poll
+#define WORKER_POLL_FDS (16)
+
+static GThread *worker_thread = NULL;
+static GMainContext *worker_context = NULL;
+static Scheduler *worker_scheduler = NULL;
+static GRecMutex worker_mutex;
+static gint worker_running = FALSE;
+
+static gpointer worker_run(gpointer null_ptr);
+static void worker_iterate(GPollFD **fds, gint *allocated_fds);
+
+// start the worker thread and move the atspi dbus connection to it
+void worker_start()
+{
+    if (worker_thread)
+        return;
+
+    // create the context for atspi
+    worker_context = g_main_context_new();
+    worker_scheduler = scheduler_new(worker_context);
+
+    // move atspi over, all atspi calls and events are now dispatched from the worker context
+    worker_lock();
+    atspi_set_main_context(worker_context);
+    worker_unlock();
+
+    // start the thread
+    g_atomic_int_set(&worker_running, TRUE);
+    worker_thread = g_thread_new("worker", worker_run, NULL);
+}
+
+// stop the worker thread and give atspi back to the default context
+void worker_stop()
+{
+    if (!worker_thread)
+        return;
+
+    // stop the thread
+    g_atomic_int_set(&worker_running, FALSE);
+    g_main_context_wakeup(worker_context);
+    g_thread_join(worker_thread);
+    worker_thread = NULL;
+
+    // move atspi back
+    atspi_set_main_context(NULL);
+
+    // free the context
+    scheduler_destroy(worker_scheduler);
+    worker_scheduler = NULL;
+    g_main_context_unref(worker_context);
+    worker_context = NULL;
+}
+
+// take the atspi lock, held by the worker thread except while it is waiting for events
+void worker_lock()
+{
+    g_rec_mutex_lock(&worker_mutex);
+}
+
+// release the atspi lock
+void worker_unlock()
+{
+    g_rec_mutex_unlock(&worker_mutex);
+}
+
+// get the context the worker thread runs
+GMainContext *worker_get_context()
+{
+    return worker_context;
+}
+
+// get the scheduler for slicing work on the worker thread, use with the lock held
+Scheduler *worker_get_scheduler()
+{
+    return worker_scheduler;
+}
+
+// attach a source to run on the worker thread, taking the reference
+guint worker_add_source(GSource *source)
+{
+    guint source_id = g_source_attach(source, worker_context);
+    g_source_unref(source);
+    return source_id;
+}
+
+// remove a source attached to the worker context
+void worker_remove_source(guint source_id)
+{
+    GSource *source = g_main_context_find_source_by_id(worker_context, source_id);
+    if (source)
+        g_source_destroy(source);
+}
+
+// run the worker loop until stopped
+static gpointer worker_run(gpointer null_ptr)
+{
+    // own the context for the life of the thread
+    g_main_context_acquire(worker_context);
+    g_main_context_push_thread_default(worker_context);
+
+    // hold the lock for everything but waiting on events
+    GPollFD *fds = g_new(GPollFD, WORKER_POLL_FDS);
+    gint allocated_fds = WORKER_POLL_FDS;
+    worker_lock();
+    while (g_atomic_int_get(&worker_running))
+        worker_iterate(&fds, &allocated_fds);
+    worker_unlock();
+    g_free(fds);
+
+    // release the context
+    g_main_context_pop_thread_default(worker_context);
+    g_main_context_release(worker_context);
+
+    return NULL;
+}
+
+// run one iteration of the worker context, releasing the lock while polling
+static void worker_iterate(GPollFD **fds, gint *allocated_fds)
+{
+    // prepare the sources
+    gint max_priority;
+    g_main_context_prepare(worker_context, &max_priority);
+
+    // get the file descriptors to poll
+    gint timeout;
+    gint num_fds;
+    while ((num_fds = g_main_context_query(worker_context, max_priority, &timeout, *fds, *allocated_fds)) > *allocated_fds)
+    {
+        *allocated_fds = num_fds;
+        *fds = g_renew(GPollFD, *fds, *allocated_fds);
+    }
+
+    // wait without the lock so other threads can use atspi
+    worker_unlock();
+    g_main_context_get_poll_func(worker_context)(*fds, num_fds, timeout);
+    worker_lock();
+
+    // dispatch the ready sources
+    if (g_main_context_check(worker_context, max_priority, *fds, num_fds))
+        g_main_context_dispatch(worker_context);
+}
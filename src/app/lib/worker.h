@@ -0,0 +1,38 @@
+/**
+ * Copyright (C) 2021 Ryan Britton
+ *
+ * This file is part of Goodnight Mouse.
+ *
+ * Goodnight Mouse is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Goodnight Mouse is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Goodnight Mouse.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef B1BFE140_1CD3_4E92_9B94_EBCFE45E306A
+#define B1BFE140_1CD3_4E92_9B94_EBCFE45E306A
+
+#include <glib.h>
+
+#include "scheduler.h"
+
+// the worker thread owns all atspi traffic, atspi callbacks are dispatched on it.
+// other threads must hold the worker lock while calling atspi
+void worker_start();
+void worker_stop();
+void worker_lock();
+void worker_unlock();
+GMainContext *worker_get_context();
+Scheduler *worker_get_scheduler();
+guint worker_add_source(GSource *source);
+void worker_remove_source(guint source_id);
+
+#endif /* B1BFE140_1CD3_4E92_9B94_EBCFE45E306A */